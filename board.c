@@ -0,0 +1,98 @@
+// Leitor do quadro de jobs publicado pela fsh (formato em board.h), no
+// estilo do ps: lê o arquivo mapeado sem falar com a shell.
+//
+//   gcc -O2 -o board board.c
+//   board [-i MS] quadro
+//
+// Sem -i mostra a tabela uma vez; com -i redesenha a cada MS milissegundos.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "board.h"
+
+#define STALE_NS 5000000000LL   // Sem passadas da shell há mais que isso: ela parou
+
+int64_t realtime_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+const char *state_name(int state) {
+    switch (state) {
+    case BOARD_RUNNING: return "rodando";
+    case BOARD_STOPPED: return "parado";
+    case BOARD_EXITED: return "terminou";
+    default: return "?";
+    }
+}
+
+void show(BoardHeader *header) {
+    BoardRecord *records = (BoardRecord *)(header + 1);
+    int64_t now = realtime_ns();
+    int64_t updated = atomic_load_explicit(&header->updated_ns, memory_order_acquire);
+    printf("fsh PID %d, atualizado há %.1fs%s\n", header->shell_pid, (now - updated) / 1e9,
+           now - updated > STALE_NS ? " (a shell não está atualizando o quadro)" : "");
+    printf("%-5s %8s %-9s %9s %9s %7s %6s  %s\n", "job", "PGID", "estado", "tempo", "CPU", "vivos", "falhas", "comando");
+    for (uint32_t i = 0; i < header->slots; i++) {
+        BoardRecord rec;
+        if (!board_read(&records[i], &rec)) {
+            continue;
+        }
+        char job[16];
+        snprintf(job, sizeof(job), "[%d]", rec.id);
+        printf("%-5s %8d %-9s %8.1fs %8.2fs %3d/%-3d %6d  %s%s%s%s\n", job, rec.pgid, state_name(rec.state),
+               rec.started_ns > 0 ? (now - rec.started_ns) / 1e9 : 0.0, rec.cpu_ns / 1e9, rec.live, rec.count,
+               rec.failed, rec.label[0] ? "%" : "", rec.label, rec.label[0] ? " " : "", rec.name);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int interval_ms = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "i:")) != -1) {
+        switch (opt) {
+        case 'i': interval_ms = atoi(optarg); break;
+        default: optind = argc + 1; break;
+        }
+    }
+    if (optind != argc - 1) {
+        fprintf(stderr, "Uso: %s [-i MS] quadro\n", argv[0]);
+        return 2;
+    }
+    int fd = open(argv[optind], O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        perror(argv[optind]);
+        return 1;
+    }
+    if ((size_t)st.st_size < sizeof(BoardHeader)) {
+        fprintf(stderr, "%s: não é um quadro de jobs da fsh\n", argv[optind]);
+        return 1;
+    }
+    BoardHeader *header = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (header == MAP_FAILED) {
+        perror("Erro ao mapear o quadro");
+        return 1;
+    }
+    if (memcmp(header->magic, BOARD_MAGIC, 8) != 0 || header->record_size != sizeof(BoardRecord) ||
+        sizeof(BoardHeader) + (size_t)header->slots * sizeof(BoardRecord) > (size_t)st.st_size) {
+        fprintf(stderr, "%s: não é um quadro de jobs desta versão da fsh\n", argv[optind]);
+        return 1;
+    }
+    do {
+        if (interval_ms > 0) {
+            printf("\033[H\033[2J");
+        }
+        show(header);
+        fflush(stdout);
+    } while (interval_ms > 0 && usleep(interval_ms * 1000) == 0);
+    return 0;
+}
@@ -0,0 +1,68 @@
+// Quadro de jobs publicado pela fsh em um arquivo mapeado (FSH_BOARD ou
+// builtin board) e lido pelo board.c ou por qualquer monitor com mmap, sem
+// chamadas de sistema nem conversa com a shell. O arquivo tem um
+// BoardHeader seguido de 'slots' BoardRecords, um por grupo em background.
+// Cada registro é protegido por um seqlock: a shell deixa 'seq' ímpar
+// enquanto escreve, e o leitor copia o registro e repete a cópia se 'seq'
+// estava ímpar ou mudou durante ela (board_read).
+#ifndef FSH_BOARD_H
+#define FSH_BOARD_H
+
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#define BOARD_MAGIC "FSHBRD1"
+#define BOARD_SLOTS 128        // Grupos ativos e recém-terminados
+#define BOARD_PIDS 100
+#define BOARD_NAME_LEN 40
+
+enum {
+    BOARD_FREE = 0,
+    BOARD_RUNNING = 1,
+    BOARD_STOPPED = 2,     // Parado (Ctrl-Z, stop), suspenso pela proteção de memória ou pelo rodízio
+    BOARD_EXITED = 3,      // Fica no quadro por alguns segundos depois do fim
+};
+
+typedef struct {
+    char magic[8];
+    int32_t shell_pid;
+    uint32_t slots;
+    uint32_t record_size;  // sizeof(BoardRecord), para conferir a versão
+    uint32_t reserved;
+    _Atomic int64_t updated_ns; // CLOCK_REALTIME da última passada da shell
+} BoardHeader;
+
+typedef struct {
+    _Atomic uint32_t seq;
+    int32_t state;
+    int32_t id;            // Número do job ([N])
+    int32_t pgid;
+    int64_t started_ns;    // CLOCK_REALTIME do primeiro processo
+    int64_t cpu_ns;        // CPU (usuário + sistema) de todos os processos até agora
+    int32_t count;         // Processos criados
+    int32_t live;          // Processos ainda em execução
+    int32_t failed;        // Processos que terminaram com erro ou sinal
+    int32_t num_pids;
+    int32_t pids[BOARD_PIDS]; // 0 para os que já terminaram
+    char label[BOARD_NAME_LEN];
+    char name[BOARD_NAME_LEN]; // Primeiro comando do grupo
+} BoardRecord;
+
+// Cópia consistente de um registro; retorna 0 se a posição está livre
+static inline int board_read(BoardRecord *shared, BoardRecord *out) {
+    uint32_t before, after;
+    do {
+        before = atomic_load_explicit(&shared->seq, memory_order_acquire);
+        if (before & 1) {
+            continue; // A shell está escrevendo
+        }
+        memcpy((char *)out + sizeof(out->seq), (char *)shared + sizeof(shared->seq),
+               sizeof(*out) - sizeof(out->seq));
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&shared->seq, memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    return out->state != BOARD_FREE;
+}
+
+#endif
@@ -0,0 +1,120 @@
+#!/bin/sh
+# Verificações da fsh pelo modo -c: códigos de saída, cadeias, arrays, fila
+# de admissão, DAG, supervisor, gangue e log de jobs.
+#
+#   gcc -O2 -o fsh fsh.c
+#   sh check.sh ./fsh
+#
+# Cada verificação roda uma fsh -c com tempo limite e compara a saída ou o
+# código de saída com o esperado. Os jobs em background têm um processo
+# secundário que roda o mesmo comando, por isso a saída deles passa por
+# uniq e os contadores são conferidos por faixa. Vale para todas as
+# variantes de compilação menos FSH_PARSE_SPACES, em que as aspas de
+# sh -c '...' não agrupam o argumento. O código de saída é 1 se alguma
+# verificação falhar.
+
+FSH=${1:?uso: sh check.sh ./fsh}
+case $FSH in
+/*) ;;
+*) FSH=$PWD/$FSH ;;
+esac
+DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$DIR"' EXIT
+cd "$DIR" || exit 1
+failures=0
+
+fail() {
+    echo "FALHOU: $1"
+    failures=$((failures + 1))
+}
+
+# status CÓDIGO LINHA [OPÇÕES]: código de saída de fsh OPÇÕES -c LINHA
+status() {
+    expected=$1
+    line=$2
+    shift 2
+    timeout 10 "$FSH" "$@" -c "$line" >/dev/null 2>&1
+    got=$?
+    [ "$got" = "$expected" ] || fail "[$line] saiu com $got, esperado $expected"
+}
+
+# output ESPERADO LINHA [FILTRO]: saída de fsh -c LINHA, passada pelo filtro
+# e com as linhas juntadas por espaço
+output() {
+    expected=$1
+    line=$2
+    filter=${3:-cat}
+    got=$(timeout 10 "$FSH" -c "$line" 2>/dev/null | sh -c "$filter" | tr '\n' ' ')
+    got=${got% }
+    [ "$got" = "$expected" ] || fail "[$line] escreveu '$got', esperado '$expected'"
+}
+
+# Código de saída: o do comando, 128 + sinal, e o pior job em background
+status 0 "true"
+status 1 "false"
+status 7 "sh -c 'exit 7'"
+status 143 "sh -c 'kill -TERM \$\$'"
+status 127 "comando-que-nao-existe"
+status 1 "true # false"
+status 0 "true # false" -n
+status 2 "true" -x
+
+# Cadeias e sintaxe composta (esta vai inteira para o /bin/sh)
+output "yes" "false && echo no || echo yes"
+output "1" 'false; echo $?'
+output "0" 'true && true; echo $?'
+output "i1 i2" 'for i in 1 2; do echo i$i; done'
+output "/" '(cd / && pwd)'
+output "A=2" "A=1 A=2 env" "grep '^A='"
+
+# Arrays: cada tarefa roda uma vez, respeitando o passo; uma falha basta
+output "t1 t2 t3 t4 t5 t6" "array 1-6%2 sh -c 'echo t\$FSH_TASK_ID'" "grep '^t' | sort -u"
+output "t1 t5 t9" "array 1-9:4 sh -c 'echo t\$FSH_TASK_ID'" "grep '^t' | sort -u"
+status 0 "array 1-3%1 true"
+status 1 "array 1-4%2 sh -c 'test \$FSH_TASK_ID -ne 3'"
+
+# Fila de admissão: com rajada 1 só o primeiro passa direto; os outros saem
+# por prioridade e, na mesma prioridade, pelo prazo mais curto
+admission="admission on cpu=100 mem=100 io=100 load=1000 burst=1 rate=5 && true"
+output "first high mid low" "$admission # echo first # prio:1 echo low # prio:9 echo high # prio:5 echo mid" \
+    "grep -x 'first\|low\|high\|mid' | uniq"
+output "first urgent soon late" "$admission # echo first # deadline:9 echo late # deadline:1 echo soon # prio:9 deadline:30 echo urgent" \
+    "grep -x 'first\|late\|soon\|urgent' | uniq"
+
+# DAG: quem depende de um job que falhou é cancelado, e o DAG sai com 1
+printf 'a -- echo A\nb after:a -- echo B\n' >ok.dag
+printf 'a -- echo A\nc after:a -- false\nd after:c -- echo D\n' >bad.dag
+status 0 "dag ok.dag"
+status 0 "dag ok.dag" -n
+status 1 "dag -j 1 bad.dag"
+output "A B" "dag -j 1 ok.dag" "grep -x 'A\|B'"
+output "A" "dag -j 1 bad.dag" "grep -x 'A\|D'"
+
+# Supervisor: com max=2 o disjuntor abre no terceiro lançamento. Sem ele,
+# com backoff de no máximo 0.1s, seriam dezenas de lançamentos até o timeout.
+timeout 3 "$FSH" -c "supervise max=2 window=10 backoff=0.05 max-backoff=0.1 cooldown=60 && true # restart:always sh -c 'echo r >> runs; exit 1'" >/dev/null 2>&1
+runs=$(cat runs 2>/dev/null | wc -l)
+[ "$runs" -ge 3 ] && [ "$runs" -le 6 ] || fail "supervisor: $runs execuções, esperado de 3 a 6"
+
+# Gangue: com uma vaga os dois grupos se revezam, e os dois terminam. Uma
+# linha de -c cria um só grupo, então aqui a shell recebe a sessão pelo stdin.
+loop="for i in 1 2 3 4 5 6; do echo \$0 >> gang; sleep 0.1; done"
+rotations=$(printf '%s\n' "gang on 1 quantum=100" "true # sh -c '$loop' A" "true # sh -c '$loop' B" \
+    waitall gang die | timeout 20 "$FSH" 2>/dev/null | sed -n 's/.* \([0-9]*\) rodízios.*/\1/p' | tail -1)
+[ "${rotations:-0}" -gt 0 ] || fail "gangue: nenhum rodízio"
+a=$(grep -c A gang 2>/dev/null)
+b=$(grep -c B gang 2>/dev/null)
+[ "${a:-0}" -ge 6 ] && [ "$a" = "$b" ] || fail "gangue: $a linhas de A e $b de B, esperado o mesmo número, ao menos 6"
+
+# Log de jobs: desligado sem FSH_JOB_LOG; cheio, é renomeado para .1
+mkdir nolog
+(cd nolog && env -u FSH_JOB_LOG timeout 10 "$FSH" -c "true # true" >/dev/null 2>&1)
+[ -z "$(ls nolog)" ] || fail "log de jobs criado sem FSH_JOB_LOG"
+FSH_JOB_LOG=$DIR/jobs.log FSH_JOB_LOG_MAX=256 timeout 10 "$FSH" -c "true # true # true # true # true" >/dev/null 2>&1
+[ -f jobs.log ] && [ -f jobs.log.1 ] || fail "log de jobs não foi rotacionado"
+
+if [ "$failures" -gt 0 ]; then
+    echo "$failures verificações falharam"
+    exit 1
+fi
+echo "Todas as verificações passaram"
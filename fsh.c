@@ -0,0 +1,6363 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <time.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <sys/prctl.h>
+#include <linux/perf_event.h>
+#include <dirent.h>
+#include <sys/timerfd.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include "session.h"
+#include "board.h"
+
+// Estratégias da shell, escolhidas em tempo de compilação. Cada combinação
+// gera um binário próprio, o que permite comparar as estratégias lado a lado:
+//   gcc -O2 -o fsh fsh.c
+//   gcc -O2 -DFSH_LAUNCHER=FSH_LAUNCH_EXECVP -o fsh-execvp fsh.c
+//   gcc -O2 -DFSH_REAPER=FSH_REAP_ANY -o fsh-reap-any fsh.c
+// O comportamento dos antigos exemplo1-4.c corresponde a
+//   gcc -O2 -DFSH_LAUNCHER=FSH_LAUNCH_EXECVP -DFSH_PARSER=FSH_PARSE_SPACES
+//       -DFSH_SECONDARY=FSH_SECONDARY_SIBLING -DFSH_SIGNALS=FSH_SIGNALS_PROCESS
+//       -DFSH_WAITALL=FSH_WAITALL_NOHANG -o fsh-exemplo fsh.c
+// e o de trabSOcomSIGINT.c ao padrão com -DFSH_SIGINT_KILLS_JOBS=0.
+//
+// FSH_LAUNCHER   como o comando é executado
+//   FSH_LAUNCH_SHELL       /bin/sh -c "comando" (padrão)
+//   FSH_LAUNCH_EXECVP      execvp direto, com os argumentos separados pelo parser
+//                          (a sintaxe composta, como if e for, ainda vai para o sh)
+// FSH_PARSER     como o comando é separado em argumentos (usado por FSH_LAUNCH_EXECVP)
+//   FSH_PARSE_QUOTES       por espaços, respeitando aspas simples e duplas (padrão)
+//   FSH_PARSE_SPACES       só por espaços, como nos exemplos originais
+// FSH_SECONDARY  onde nasce o processo secundário Px' de cada comando em background
+//   FSH_SECONDARY_CHILD    filho de Px, no mesmo grupo (padrão)
+//   FSH_SECONDARY_SIBLING  irmão de Px, criado e reapado pela própria shell
+//   FSH_SECONDARY_NONE     sem processo secundário
+// FSH_REAPER     como os processos em background são reapados
+//   FSH_REAP_PER_PID       waitpid(pid, WNOHANG) para cada processo conhecido (padrão)
+//   FSH_REAP_ANY           waitpid(-1, WNOHANG) até não haver mais filhos terminados
+// FSH_WAITALL    comportamento do waitall
+//   FSH_WAITALL_BLOCKING   espera todos os filhos terminarem (padrão)
+//   FSH_WAITALL_NOHANG     só coleta os que já terminaram
+// FSH_SIGNALS    política de sinais
+//   FSH_SIGNALS_GROUP      cada job em seu grupo; Ctrl-Z envia SIGSTOP ao grupo (padrão)
+//   FSH_SIGNALS_PROCESS    jobs no grupo da shell; Ctrl-Z envia SIGTSTP a cada PID
+// FSH_SIGINT_KILLS_JOBS  1: confirmar a saída com Ctrl-C mata os jobs (padrão); 0: só sai
+#define FSH_LAUNCH_SHELL 1
+#define FSH_LAUNCH_EXECVP 2
+#define FSH_PARSE_QUOTES 1
+#define FSH_PARSE_SPACES 2
+#define FSH_SECONDARY_CHILD 1
+#define FSH_SECONDARY_SIBLING 2
+#define FSH_SECONDARY_NONE 3
+#define FSH_REAP_PER_PID 1
+#define FSH_REAP_ANY 2
+#define FSH_WAITALL_BLOCKING 1
+#define FSH_WAITALL_NOHANG 2
+#define FSH_SIGNALS_GROUP 1
+#define FSH_SIGNALS_PROCESS 2
+
+#ifndef FSH_LAUNCHER
+#define FSH_LAUNCHER FSH_LAUNCH_SHELL
+#endif
+#ifndef FSH_PARSER
+#define FSH_PARSER FSH_PARSE_QUOTES
+#endif
+#ifndef FSH_SECONDARY
+#define FSH_SECONDARY FSH_SECONDARY_CHILD
+#endif
+#ifndef FSH_REAPER
+#define FSH_REAPER FSH_REAP_PER_PID
+#endif
+#ifndef FSH_WAITALL
+#define FSH_WAITALL FSH_WAITALL_BLOCKING
+#endif
+#ifndef FSH_SIGNALS
+#define FSH_SIGNALS FSH_SIGNALS_GROUP
+#endif
+#ifndef FSH_SIGINT_KILLS_JOBS
+#define FSH_SIGINT_KILLS_JOBS 1
+#endif
+
+#if FSH_SIGNALS == FSH_SIGNALS_GROUP
+#define FSH_STOP_SIGNAL SIGSTOP
+#else
+#define FSH_STOP_SIGNAL SIGTSTP
+#endif
+
+#define MAX_BUFFER 1024
+#define MAX_COMMANDS 5
+#define MAX_PROCESSES 100
+#define MAX_ARGS 64
+#define MAX_DAG_JOBS 256
+#define MAX_DAG_DEPS 16
+#define MAX_DAG_NAME 64
+#define JOB_NAME_LEN 40
+#define MAX_QUEUED_JOBS 256
+#define ADMISSION_QUEUE_MAX (1 << 20)   // Comandos na fila de admissão (heap)
+#define MAX_SHARES 32                   // Remetentes com peso próprio na fila
+#define SHARE_SCALE 1000000ULL          // Custo virtual de um comando com peso 1
+#define ADMISSION_SAMPLE_NS 250000000LL // Intervalo mínimo entre leituras de /proc/pressure
+#define ADMISSION_POLL_MS 50            // Espera do loop principal enquanto há fila
+#define MEMGUARD_STEP_NS 1000000000LL   // Intervalo mínimo entre suspensões/retomadas
+#define MAX_NUMA_NODES 64
+#define MAX_TIMERS 8192
+#define MAX_TREE_PIDS 1024              // Descendentes alcançados pelo prazo de um comando
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_LEVELS 4                  // 64^4 ticks de 100ms: cerca de 19 dias
+#define TIMER_TICK_NS 100000000LL
+#define DEFAULT_GRACE_MS 5000           // Carência entre SIGTERM e SIGKILL
+#define MAX_ENV_OVERRIDES 32
+#define PLACEMENT_DESC_LEN 32
+#define MAX_OUTPUT_STREAMS MAX_PROCESSES
+#define MAX_TASKS 16
+#define MAX_ARRAYS 16
+#define MAX_WORKERS 16
+#define WORKER_STOP_TIMEOUT_MS 5000     // Espera pelo EOF dos trabalhadores no stop
+#define MAX_SUPERVISED 32
+#define SUPERVISE_MAX_RESTARTS 32       // Reinícios lembrados por job para o disjuntor
+#define JOB_WAIT_POLL_MS 50             // Intervalo de verificação do job em foreground
+#define NOTIFY_BUF_LEN 65536
+#define NOTIFY_BURST 20                 // Avisos individuais por janela
+#define NOTIFY_WINDOW_NS 1000000000LL
+#define MAX_PROFILED 256                // Filhos com contadores abertos ao mesmo tempo
+#define PROF_COUNTERS 5
+#define OUTPUT_BUF_LEN 4096             // Maior linha remontada antes de ser quebrada
+#define OUTPUT_IOV_MAX 512
+
+// Constantes de ioprio_set(2), que a glibc não exporta
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_CLASS_NONE 0
+#define IOPRIO_CLASS_BE 2
+#define IOPRIO_CLASS_IDLE 3
+#define IOPRIO_WHO_PROCESS 1
+#define IOPRIO_WHO_PGRP 2
+
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1 // Valor de <linux/mempolicy.h>, sem depender da libnuma
+#endif
+#define JOB_LOG_DEFAULT_MAX (64L * 1024 * 1024) // Tamanho máximo do log antes da rotação
+#define BOARD_CPU_INTERVAL_NS 1000000000LL // Amostragem da CPU dos jobs para o quadro
+#define BOARD_LINGER_NS 5000000000LL       // Tempo de um grupo terminado no quadro
+
+typedef struct {
+    pid_t pids[MAX_PROCESSES];
+    int64_t started_ns[MAX_PROCESSES];        // Instante de criação de cada processo
+    uint64_t hashes[MAX_PROCESSES];           // Hash do comando de cada processo
+    char names[MAX_PROCESSES][JOB_NAME_LEN];  // Comando (truncado) de cada processo
+    char cpus[MAX_PROCESSES][PLACEMENT_DESC_LEN]; // CPUs atribuídas a cada processo
+    signed char nodes[MAX_PROCESSES];         // Nó NUMA preferido (-1 vários, -2 sem placement)
+    int timers[MAX_PROCESSES];                // Timer do prazo de cada processo (-1 sem prazo)
+    int count;
+    int id;                                   // Identificador estável do grupo
+    int deadline_timer;                       // Timer do prazo do grupo inteiro
+    int64_t active_ns;                        // Último lançamento ou retomada (ordem lru)
+    int paused_seq;                           // Ordem da suspensão por memória (0 = rodando)
+    pid_t pgid;                               // Grupo de processos comum à linha (0 sem grupo próprio)
+    int stopped;                              // Suspenso pelo usuário (Ctrl-Z, stop)
+    char label[JOB_NAME_LEN];                 // Nome dado com o prefixo name:, para %nome
+    int failed;                               // Processos que terminaram com erro ou sinal
+    int exit_status;                          // Status bruto do último que falhou
+    int reaped;                               // Processos que já terminaram
+    int array;                                // Array de jobs dono do grupo (índice + 1, 0 nenhum)
+    int remote;                               // No trabalhador: id do job no coordenador (0 nenhum)
+    int64_t cpu_ns;                           // CPU dos processos já reapados
+    int supervised;                           // Jobs supervisionados presos ao grupo
+    int gang_paused;                          // Parado pelo escalonamento em gangue
+    int64_t gang_ns;                          // Tempo rodando sob o escalonamento em gangue
+} ProcessGroup;
+
+typedef struct {
+    int active;
+    int group_id;
+    char command[MAX_BUFFER];
+    long start, end, step;
+    long total;
+    int limit;                    // Tarefas rodando ao mesmo tempo
+    long next;                    // Próxima tarefa a lançar (0..total-1)
+    long done, failed;
+    int running;
+    int cancelled;
+    uint64_t *done_bits;          // Um bit por tarefa
+    uint64_t *failed_bits;
+    pid_t pids[MAX_PROCESSES];    // Processo de cada tarefa em execução
+    long tasks[MAX_PROCESSES];
+} JobArray;
+
+typedef enum { RESTART_NEVER, RESTART_ON_FAILURE, RESTART_ALWAYS } RestartPolicy;
+typedef enum { SUP_RUNNING, SUP_LAUNCHING, SUP_WAITING, SUP_BROKEN, SUP_STOPPING } SupervisedState;
+
+typedef struct {
+    int active;
+    SupervisedState state;
+    RestartPolicy policy;
+    int group_id;
+    pid_t pid;
+    char command[MAX_BUFFER];     // Comando original, com os prefixos
+    char health[MAX_BUFFER];      // Verificação de saúde (vazio sem verificação)
+    char name[JOB_NAME_LEN];      // Comando sem os prefixos, para os avisos
+    int64_t started_ns;
+    int restarts;
+    int backoff_step;             // Falhas seguidas, expoente do backoff
+    int64_t restart_ns[SUPERVISE_MAX_RESTARTS]; // Instantes dos últimos reinícios (anel)
+    int half_open;                // Tentativa depois do disjuntor aberto
+    int timer;                    // Reinício agendado (-1 nenhum)
+    int health_timer;
+    pid_t health_pid;             // Verificação em andamento (0 nenhuma)
+    int health_failures;          // Verificações seguidas que falharam
+} Supervised;
+
+typedef struct {
+    int max_restarts;             // Reinícios dentro da janela que abrem o disjuntor
+    int64_t window_ms, cooldown_ms;
+    int64_t backoff_ms, max_backoff_ms;
+    int64_t stable_ms;            // Tempo rodando que zera o backoff
+    int64_t health_every_ms;
+    int health_fails;             // Verificações seguidas que derrubam o job
+} SupervisorConfig;
+
+typedef struct {
+    int id;
+    pid_t pid;
+    int fd;                       // Socket com o trabalhador (-1 depois que ele sai)
+    int node;                     // Nó NUMA (índice) ou -1
+    char cgroup[256];
+    int slots;                    // Jobs simultâneos no trabalhador
+    int queued, running;          // Último "load" recebido, mais os jobs enviados depois
+    int dispatched, stolen, done, failed;
+    int stolen_by;                // Trabalhador (id) à espera do roubo pedido a este
+    int steal_from;               // Trabalhador (id) a quem este pediu trabalho
+} Worker;
+
+// Espera assíncrona por grupos (waitall &, wait %job &)
+typedef struct {
+    int active;
+    int id;
+    char desc[64];
+    int ids[MAX_PROCESSES + MAX_QUEUED_JOBS]; // Grupos ainda pendentes
+    int num_ids;
+    int finished, failed;
+    int64_t started_ns;
+} WaitTask;
+
+typedef struct {
+    int64_t expire;           // Tick de vencimento
+    int group_id;             // -1 para o job em foreground
+    pid_t pid;                // 0 para o grupo inteiro
+    int stage;                // 0 envia SIGTERM, 1 envia SIGKILL, 2 e 3 são do supervisor, 4 é o rodízio
+    int level, slot;
+    int next, prev;
+    int in_use;
+} TimerNode;
+
+typedef struct {
+    int fd;                   // timerfd que acorda o loop principal
+    int64_t base_ns;
+    int64_t now;              // Último tick processado
+    int slots[WHEEL_LEVELS][WHEEL_SLOTS]; // Listas duplamente ligadas de TimerNode
+    int free_list;
+    int count;
+} TimerWheel;
+
+typedef struct {
+    int64_t default_ms;       // Prazo padrão dos grupos em background (0 = sem prazo)
+    int64_t grace_ms;
+} JobTimeouts;
+
+// Prefixos opcionais de um comando: "cpuset:LISTA", "timeout:N", "name:ROTULO",
+// "restart:POLITICA", "health:CMD", "prio:N", "deadline:S", "share:NOME" e "NOME=valor"
+typedef struct {
+    char *cpus;
+    int64_t timeout_ms;
+    char *env[MAX_ENV_OVERRIDES]; // "NOME=valor", apontando para o buffer do comando
+    int num_env;
+    char *name;                   // Rótulo do grupo (name:ROTULO)
+    int priority;                 // prio:N, só para a fila de admissão
+    int64_t deadline_ms;          // deadline:S, idem (0 sem prazo)
+    char *share;                  // share:NOME, idem
+    int restart;                  // RestartPolicy do prefixo restart: (-1 sem supervisão)
+    char *health;                 // Verificação de saúde (health:CMD)
+} JobOptions;
+
+// Pipe de saída de um processo em background no modo tagged
+typedef struct {
+    int fd;
+    int eof;
+    char prefix[32]; // "[job:pid] "
+    int prefix_len;
+    size_t len;
+    char buf[OUTPUT_BUF_LEN];
+} OutputStream;
+
+typedef struct {
+    char *base;
+    size_t size;
+    size_t used;
+} Arena;
+
+typedef struct {
+    char command[MAX_BUFFER];
+    int group_id;             // Grupo ao qual o comando pertence
+} QueuedJob;
+
+// Comando à espera de admissão. A fila é um heap binário: sai primeiro a
+// maior prioridade, depois o prazo mais cedo (EDF), depois a marca de
+// compartilhamento justo do remetente e por fim a ordem de chegada.
+typedef struct {
+    int priority;             // prio:N (maior sai antes)
+    int group_id;
+    int64_t deadline_ns;      // deadline:S já em tempo absoluto (INT64_MAX sem prazo)
+    uint64_t tag;             // Tempo virtual de término do remetente (share:NOME)
+    uint64_t seq;
+    int share;                // Remetente (índice em shares)
+    char *command;            // Cópia própria (strdup)
+} PendingJob;
+
+typedef struct {
+    char name[JOB_NAME_LEN];  // "" é o remetente padrão
+    int weight;
+    uint64_t finish;          // Marca do último comando enfileirado
+    long queued, launched;
+} Share;
+
+// Estado do processo quando ele é um trabalhador
+typedef struct {
+    int fd;
+    int slots;
+    QueuedJob queue[MAX_QUEUED_JOBS]; // group_id guarda o id do job no coordenador
+    int head, len;
+    int reported_queued, reported_running;
+    int quit;
+} WorkerState;
+
+typedef struct {
+    int policy;               // SCHED_OTHER, SCHED_BATCH ou SCHED_IDLE
+    int nice;
+    int io_class;             // IOPRIO_CLASS_*
+} SchedClass;
+
+typedef enum { PLACE_NONE, PLACE_RR, PLACE_PACK, PLACE_SPREAD } PlacementPolicy;
+
+typedef struct {
+    PlacementPolicy policy;
+    int reserve;                          // CPUs 0..reserve-1 ficam para o foreground
+    int loaded;
+    int num_nodes;
+    int node_ids[MAX_NUMA_NODES];
+    cpu_set_t node_cpus[MAX_NUMA_NODES];
+    cpu_set_t allowed;                    // Afinidade herdada pela shell
+    int next_cpu, next_node;              // Rodízio das políticas rr e spread
+} Placement;
+
+typedef struct {
+    int enabled;
+    double max_cpu, max_memory, max_io;  // Limites de "some avg10" do PSI (%)
+    double max_load;                     // Limite de loadavg de 1 minuto (0 = sem limite)
+    double rate, burst, tokens;          // Token bucket de criação de processos
+    int64_t refilled_ns;
+    double cpu, memory, io, load;        // Última leitura
+    int64_t sampled_ns;
+} AdmissionControl;
+
+typedef struct {
+    int enabled;
+    int slots;                    // Grupos rodando ao mesmo tempo (K)
+    int64_t quantum_ms;
+    int timer;                    // Próximo rodízio (-1 nenhum)
+    int exempt_id;                // Grupo em foreground, fora do rodízio
+    int64_t accounted_ns;         // Até quando o tempo rodando já foi somado
+    long rotations, switches;
+} GangScheduler;
+
+typedef enum { MEMGUARD_LRU, MEMGUARD_RSS } MemGuardOrder;
+
+typedef struct {
+    int enabled;
+    MemGuardOrder order;
+    double max_pressure, resume_pressure;   // "some avg10" de /proc/pressure/memory (%)
+    double min_available, resume_available; // MemAvailable em % de MemTotal
+    double pressure, available;             // Última leitura
+    int64_t acted_ns;
+    int seq;
+    int paused;                             // Grupos suspensos no momento
+} MemoryGuard;
+
+// Registro de tamanho fixo do histórico de jobs (128 bytes)
+typedef struct {
+    uint64_t argv_hash;       // FNV-1a do comando
+    int32_t pgid;
+    int32_t status;           // Status bruto retornado por wait4
+    int64_t start_ns;         // CLOCK_REALTIME
+    int64_t end_ns;
+    int64_t utime_us;
+    int64_t stime_us;
+    int64_t maxrss_kb;
+    int64_t minflt;
+    int64_t majflt;
+    int64_t nvcsw;
+    int64_t nivcsw;
+    char command[JOB_NAME_LEN];
+} JobRecord;
+
+// Cabeçalho do log, ocupa o primeiro slot do arquivo
+typedef struct {
+    char magic[8];
+    uint64_t count;           // Registros já gravados
+    uint64_t capacity;        // Registros que cabem no arquivo
+    char reserved[sizeof(JobRecord) - 24];
+} JobLogHeader;
+
+#define HIST_SUB_BITS 2
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS (64 * HIST_SUB)
+
+typedef struct {
+    _Atomic uint64_t buckets[HIST_BUCKETS];
+    _Atomic uint64_t count;
+    _Atomic uint64_t sum_ns;
+} Histogram;
+
+typedef struct {
+    _Atomic uint64_t spawns;
+    _Atomic uint64_t spawn_failures;
+    _Atomic uint64_t reaps;
+    _Atomic uint64_t signals_forwarded;
+    _Atomic int64_t active_jobs;
+    _Atomic int64_t pending_exit_ns; // Primeiro SIGCHLD ainda não atendido
+    Histogram spawn_to_exec;
+    Histogram exit_to_reap;
+} ShellMetrics;
+
+typedef struct {
+    char buf[NOTIFY_BUF_LEN];     // Avisos para o terminal
+    size_t len;
+    char events[NOTIFY_BUF_LEN];  // Eventos em JSON por linha
+    size_t events_len;
+    int event_fd;
+    int64_t window_ns;            // Início da janela do limite de taxa
+    int shown;                    // Avisos da janela atual
+    int started, finished, failed; // Suprimidos na janela atual
+    int quiet;                    // Sem avisos no terminal (trabalhadores)
+} Notifier;
+
+enum { PROF_FORK, PROF_EXEC, PROF_RUN, PROF_REAP, PROF_PHASES };
+
+typedef struct {
+    uint32_t type;
+    uint64_t config;
+    const char *name;
+} ProfileCounter;
+
+typedef struct {
+    pid_t pid;
+    int fds[PROF_COUNTERS];
+    uint64_t exec[PROF_COUNTERS]; // Valores ao fim do exec
+} ProfiledChild;
+
+typedef struct {
+    int enabled;
+    int user_only;                // Sem permissão para contar o kernel
+    int counter_ok[PROF_COUNTERS];
+    int self_fds[PROF_COUNTERS];
+    int gate[2];                  // Segura o filho até os contadores estarem abertos
+    ProfiledChild children[MAX_PROFILED];
+    int num_children;
+    Histogram hist[PROF_PHASES][PROF_COUNTERS]; // Histogramas reaproveitados para contagens
+} Profiler;
+
+_Static_assert(sizeof(JobRecord) == 128, "JobRecord deve ter 128 bytes");
+_Static_assert(sizeof(JobLogHeader) == sizeof(JobRecord), "cabeçalho ocupa um registro");
+
+typedef enum { DAG_PENDENTE, DAG_EXECUTANDO, DAG_OK, DAG_FALHOU, DAG_CANCELADO } DagState;
+
+typedef struct {
+    char name[MAX_DAG_NAME];
+    char command[MAX_BUFFER];
+    char dep_names[MAX_DAG_DEPS][MAX_DAG_NAME];
+    int deps[MAX_DAG_DEPS];   // Índices dos jobs dos quais este depende
+    int num_deps;
+    int remaining;            // Dependências ainda não concluídas
+    long cost;                // Custo estimado do job (cost:N, padrão 1)
+    long rank;                // Custo do caminho crítico a partir deste job
+    int64_t started_ns;
+    int group_id;             // Grupo em background que roda o job (0 antes de lançar)
+    DagState state;
+} DagJob;
+
+// Execução do DAG em andamento, avançada a cada volta do loop principal
+typedef struct {
+    int active;
+    int stopped;              // Suspenso com Ctrl-Z; nenhum job novo é iniciado até "dag cont"
+    int max_parallel;
+    int running, finished, ok, failed, cancelled;
+    int64_t started_ns;
+} DagRun;
+
+pid_t fg_process_pid = 0;
+int last_status = 0; // $?: código de saída do último comando em foreground, 128 + sinal se morto ou suspenso
+ProcessGroup bg_process_groups[MAX_PROCESSES];
+int num_bg_process_groups = 0;
+DagJob dag_jobs[MAX_DAG_JOBS];
+int num_dag_jobs = 0;
+DagRun dag_run = { .active = 0 };
+JobLogHeader *job_log = NULL;    // Log de histórico mapeado em memória
+char job_log_path[MAX_BUFFER];
+long job_log_max = JOB_LOG_DEFAULT_MAX;
+size_t job_log_size = 0;         // Bytes mapeados
+int job_log_retry = 0;           // Rotação sem reabertura: tentar de novo na próxima gravação
+int next_group_id = 1;
+PendingJob *admission_queue = NULL; // Heap de comandos aguardando admissão
+int admission_len = 0;
+int admission_cap = 0;
+uint64_t admission_seq = 0;
+uint64_t admission_vclock = 0;   // Marca do último comando que saiu da fila
+long admission_missed = 0;       // Comandos que saíram da fila depois do prazo
+Share shares[MAX_SHARES] = { { .name = "", .weight = 1 } };
+int num_shares = 1;
+int *queued_ids = NULL;          // Hash id do grupo -> comandos na fila (endereçamento aberto)
+int *queued_counts = NULL;
+int queued_ids_cap = 0;
+AdmissionControl admission = {
+    .enabled = 0, .max_cpu = 80, .max_memory = 10, .max_io = 50,
+    .rate = 100, .burst = 200, .tokens = 200,
+};
+Placement placement = { .policy = PLACE_NONE };
+MemoryGuard memguard = {
+    .enabled = 0, .order = MEMGUARD_LRU, .max_pressure = 25, .resume_pressure = 5,
+    .min_available = 5, .resume_available = 10,
+};
+GangScheduler gang = { .quantum_ms = 500, .timer = -1 };
+TimerNode timer_pool[MAX_TIMERS];
+TimerWheel wheel = { .fd = -1 };
+JobTimeouts job_timeouts = { .default_ms = 0, .grace_ms = DEFAULT_GRACE_MS };
+int fg_timer = -1;
+WaitTask wait_tasks[MAX_TASKS];
+JobArray job_arrays[MAX_ARRAYS];
+Supervised supervised[MAX_SUPERVISED];
+SupervisorConfig supervisor = {
+    .max_restarts = 5, .window_ms = 60000, .cooldown_ms = 60000, .backoff_ms = 1000, .max_backoff_ms = 60000,
+    .stable_ms = 10000, .health_every_ms = 10000, .health_fails = 3,
+};
+unsigned int supervise_seed = 0;  // Jitter do backoff
+Worker workers[MAX_WORKERS];
+int num_workers = 0;
+int next_remote_id = 1;
+int remote_pending = 0;           // Jobs enviados aos trabalhadores e ainda não concluídos
+WorkerState worker;               // Zerado (fora do .data): slots > 0 só no modo trabalhador
+int next_task_id = 1;
+volatile sig_atomic_t fg_stop_requested = 0; // SIGTSTP chegou enquanto havia um job em foreground
+volatile sig_atomic_t child_exited = 0; // SIGCHLD ainda não atendido (modo -c)
+Arena spawn_arena = { NULL, 0, 0 };
+OutputStream output_streams[MAX_OUTPUT_STREAMS];
+int num_output_streams = 0;
+int output_tagged = 0;
+int session_fd = -1;             // Gravação da sessão (record / FSH_RECORD)
+BoardHeader *board = NULL;        // Quadro de jobs (board / FSH_BOARD)
+int64_t board_cpu_sampled_ns = 0;
+int64_t board_exited_ns[BOARD_SLOTS]; // Quando cada grupo terminado entrou no quadro
+int64_t session_start_ns;
+SchedClass bg_sched_class = { .policy = SCHED_BATCH, .nice = 10, .io_class = IOPRIO_CLASS_IDLE };
+SchedClass fg_sched_class = { .policy = SCHED_OTHER, .nice = 0, .io_class = IOPRIO_CLASS_NONE };
+ShellMetrics metrics_fallback;
+ShellMetrics *metrics = &metrics_fallback; // Trocado por memória compartilhada em metrics_init
+Profiler profiler = { .gate = { -1, -1 } };
+Notifier notifier = { .event_fd = -1 };
+
+void terminate_all_processes();
+ProcessGroup *find_bg_group(int id);
+ProcessGroup *find_job(const char *spec);
+void reap_background_processes();
+void supervise_started(const char *command, ProcessGroup *group, pid_t pid, JobOptions *opts);
+void supervise_timer(TimerNode *t);
+void supervise_cancel_group(ProcessGroup *group);
+void supervise_jobs_lines(ProcessGroup *group);
+void gang_timer();
+void compact_bg_groups();
+DagJob *find_dag_group(int id);
+int is_compound_line(const char *line);
+void session_event(int type, int answer, pid_t pid, int status, const char *data, size_t len);
+
+// Métricas da shell. Os contadores ficam em memória compartilhada anônima e
+// são atualizados com atômicos sem lock, o que permite incrementá-los dentro
+// dos tratadores de sinal e lê-los a partir do processo exportador.
+int64_t mono_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Histograma log-linear (estilo HDR): cada potência de 2 é dividida em
+// HIST_SUB sub-faixas, o que dá erro relativo máximo de 1/HIST_SUB.
+int hist_index(uint64_t v) {
+    if (v < HIST_SUB) {
+        return (int)v;
+    }
+    int msb = 63 - __builtin_clzll(v);
+    int shift = msb - HIST_SUB_BITS;
+    return (shift + 1) * HIST_SUB + (int)((v >> shift) & (HIST_SUB - 1));
+}
+
+// Limite superior (exclusivo) do bucket i, em nanossegundos
+uint64_t hist_upper(int i) {
+    if (i < HIST_SUB) {
+        return (uint64_t)i + 1;
+    }
+    int group = i / HIST_SUB;
+    uint64_t upper = (uint64_t)(HIST_SUB + i % HIST_SUB + 1) << (group - 1);
+    return upper ? upper : UINT64_MAX;
+}
+
+void hist_record(Histogram *h, int64_t v) {
+    if (v < 0) {
+        v = 0;
+    }
+    atomic_fetch_add_explicit(&h->buckets[hist_index((uint64_t)v)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->sum_ns, (uint64_t)v, memory_order_relaxed);
+}
+
+void metrics_init() {
+    void *map = mmap(NULL, sizeof(ShellMetrics), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (map != MAP_FAILED) {
+        metrics = map; // Zerada pelo kernel
+    }
+}
+
+void metrics_spawned(int tracked) {
+    atomic_fetch_add_explicit(&metrics->spawns, 1, memory_order_relaxed);
+    if (tracked) {
+        atomic_fetch_add_explicit(&metrics->active_jobs, 1, memory_order_relaxed);
+    }
+}
+
+void metrics_spawn_failed() {
+    atomic_fetch_add_explicit(&metrics->spawn_failures, 1, memory_order_relaxed);
+}
+
+// Conta um processo reapado. A latência saída->reap é medida a partir do
+// primeiro SIGCHLD ainda não atendido, registrado por handle_sigchld.
+void metrics_reaped() {
+    atomic_fetch_add_explicit(&metrics->reaps, 1, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&metrics->active_jobs, 1, memory_order_relaxed);
+    int64_t exited = atomic_load_explicit(&metrics->pending_exit_ns, memory_order_relaxed);
+    if (exited != 0) {
+        hist_record(&metrics->exit_to_reap, mono_ns() - exited);
+    }
+}
+
+// Fim de uma rodada de reaps: o próximo SIGCHLD inicia uma nova medição
+void metrics_reap_pass_done() {
+    atomic_store_explicit(&metrics->pending_exit_ns, 0, memory_order_relaxed);
+}
+
+void handle_sigchld(int sig) {
+    (void)sig; // Marcar o parâmetro como utilizado para evitar avisos
+    child_exited = 1;
+    int64_t expected = 0;
+    atomic_compare_exchange_strong(&metrics->pending_exit_ns, &expected, mono_ns());
+}
+
+// Pipe com O_CLOEXEC usado para medir a latência entre fork e exec: a ponta
+// de escrita fica com o filho e é fechada pelo kernel quando o exec conclui,
+// então o pai só precisa ler até EOF. O intermediário de FSH_SECONDARY_CHILD
+// escreve nele o PID de Px', que o pai não teria como saber.
+void exec_probe_open(int probe[2]) {
+    if (pipe2(probe, O_CLOEXEC) < 0) {
+        probe[0] = probe[1] = -1;
+    }
+}
+
+void exec_probe_child(int probe[2]) {
+    if (probe[0] >= 0) {
+        close(probe[0]);
+    }
+}
+
+// Retorna o PID escrito no pipe pelos filhos, ou 0
+pid_t exec_probe_wait(int probe[2], int64_t fork_ns) {
+    if (probe[0] < 0) {
+        return 0;
+    }
+    close(probe[1]);
+    pid_t pids[2] = { 0, 0 };
+    size_t got = 0;
+    ssize_t n;
+    while ((n = read(probe[0], (char *)pids + got, sizeof(pids) - got)) != 0) {
+        if (n > 0) {
+            got += n;
+        } else if (errno != EINTR) {
+            break;
+        }
+    }
+    close(probe[0]);
+    hist_record(&metrics->spawn_to_exec, mono_ns() - fork_ns);
+    return got >= sizeof(pid_t) ? pids[0] : 0;
+}
+
+void exec_probe_close(int probe[2]) {
+    if (probe[0] >= 0) {
+        close(probe[0]);
+        close(probe[1]);
+    }
+}
+
+// Perfil do caminho de criação de processos com perf_event_open. Com o
+// perfil ligado, cada criação em foreground ou background é medida em fases:
+//   fork  a chamada fork() no pai (cópia das tabelas de páginas)
+//   exec  o filho, do retorno do fork até o exec concluir
+//   vida  o filho depois do exec até ser reapado (faltas de página iniciais)
+//   reap  o pai coletando os filhos terminados
+// Os contadores do filho são abertos pelo pai logo depois do fork; para não
+// perder o começo, o filho espera em um pipe até o pai liberá-lo.
+const ProfileCounter profile_counters[PROF_COUNTERS] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, "ciclos" },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, "instruções" },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MIN, "faltas menores" },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MAJ, "faltas maiores" },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES, "trocas de contexto" },
+};
+const char *profile_phase_names[PROF_PHASES] = { "fork", "exec", "vida", "reap" };
+
+int profile_open(int counter, pid_t pid) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = profile_counters[counter].type;
+    attr.config = profile_counters[counter].config;
+    attr.exclude_kernel = profiler.user_only;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, pid, -1, -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+void profile_read(int fds[PROF_COUNTERS], uint64_t values[PROF_COUNTERS]) {
+    for (int c = 0; c < PROF_COUNTERS; c++) {
+        values[c] = 0;
+        if (fds[c] >= 0 && read(fds[c], &values[c], sizeof(uint64_t)) != sizeof(uint64_t)) {
+            values[c] = 0;
+        }
+    }
+}
+
+void profile_close(int fds[PROF_COUNTERS]) {
+    for (int c = 0; c < PROF_COUNTERS; c++) {
+        if (fds[c] >= 0) {
+            close(fds[c]);
+            fds[c] = -1;
+        }
+    }
+}
+
+void profile_record(int phase, const uint64_t before[PROF_COUNTERS], const uint64_t after[PROF_COUNTERS]) {
+    for (int c = 0; c < PROF_COUNTERS; c++) {
+        hist_record(&profiler.hist[phase][c], (int64_t)(after[c] - before[c]));
+    }
+}
+
+// Leitura dos contadores da própria shell no início de uma fase
+void profile_self_begin(uint64_t values[PROF_COUNTERS]) {
+    if (profiler.enabled) {
+        profile_read(profiler.self_fds, values);
+    }
+}
+
+void profile_self_end(int phase, const uint64_t before[PROF_COUNTERS]) {
+    if (profiler.enabled) {
+        uint64_t after[PROF_COUNTERS];
+        profile_read(profiler.self_fds, after);
+        profile_record(phase, before, after);
+    }
+}
+
+// Antes do fork: cria o pipe que segura o filho e lê os contadores da shell
+void profile_before_fork(uint64_t values[PROF_COUNTERS]) {
+    profiler.gate[0] = profiler.gate[1] = -1;
+    if (profiler.enabled && pipe2(profiler.gate, O_CLOEXEC) == 0) {
+        profile_read(profiler.self_fds, values);
+    }
+}
+
+void profile_child_wait() {
+    if (profiler.gate[0] >= 0) {
+        char c;
+        close(profiler.gate[1]);
+        while (read(profiler.gate[0], &c, 1) < 0 && errno == EINTR);
+        close(profiler.gate[0]);
+    }
+}
+
+// No pai, logo depois do fork: fecha a fase fork, abre os contadores do
+// filho e o libera
+void profile_after_fork(pid_t pid, const uint64_t before[PROF_COUNTERS]) {
+    if (profiler.gate[0] < 0) {
+        return;
+    }
+    if (pid > 0) {
+        uint64_t after[PROF_COUNTERS];
+        profile_read(profiler.self_fds, after);
+        profile_record(PROF_FORK, before, after);
+        ProfiledChild *child = &profiler.children[profiler.num_children];
+        if (profiler.num_children < MAX_PROFILED) {
+            child->pid = pid;
+            for (int c = 0; c < PROF_COUNTERS; c++) {
+                child->fds[c] = profiler.counter_ok[c] ? profile_open(c, pid) : -1;
+            }
+            profiler.num_children++;
+        }
+    }
+    close(profiler.gate[0]);
+    close(profiler.gate[1]); // EOF libera o filho
+    profiler.gate[0] = profiler.gate[1] = -1;
+}
+
+ProfiledChild *profile_find(pid_t pid) {
+    for (int i = 0; i < profiler.num_children; i++) {
+        if (profiler.children[i].pid == pid) {
+            return &profiler.children[i];
+        }
+    }
+    return NULL;
+}
+
+// Depois do exec_probe_wait: o exec do filho terminou
+void profile_exec_done(pid_t pid) {
+    ProfiledChild *child = profile_find(pid);
+    if (child != NULL) {
+        static const uint64_t zero[PROF_COUNTERS];
+        profile_read(child->fds, child->exec);
+        profile_record(PROF_EXEC, zero, child->exec);
+    }
+}
+
+// O filho foi reapado: os contadores guardam o valor final
+void profile_reaped(pid_t pid) {
+    ProfiledChild *child = profile_find(pid);
+    if (child == NULL) {
+        return;
+    }
+    uint64_t total[PROF_COUNTERS];
+    profile_read(child->fds, total);
+    profile_record(PROF_RUN, child->exec, total);
+    profile_close(child->fds);
+    *child = profiler.children[--profiler.num_children];
+}
+
+uint64_t hist_percentile(Histogram *h, double p) {
+    uint64_t count = atomic_load_explicit(&h->count, memory_order_relaxed);
+    uint64_t target = (uint64_t)(p * count), cumulative = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        cumulative += atomic_load_explicit(&h->buckets[i], memory_order_relaxed);
+        if (cumulative > target) {
+            return hist_upper(i) - 1; // Maior valor do bucket
+        }
+    }
+    return 0;
+}
+
+int profile_start() {
+    memset(profiler.hist, 0, sizeof(profiler.hist));
+    for (int pass = 0; pass < 2; pass++) {
+        profiler.user_only = pass; // Sem permissão para o kernel, só espaço de usuário
+        int opened = 0;
+        for (int c = 0; c < PROF_COUNTERS; c++) {
+            profiler.self_fds[c] = profile_open(c, 0);
+            profiler.counter_ok[c] = profiler.self_fds[c] >= 0;
+            opened += profiler.counter_ok[c];
+        }
+        if (opened > 0) {
+            profiler.enabled = 1;
+            return 0;
+        }
+    }
+    perror("Erro no perf_event_open");
+    return -1;
+}
+
+void profile_stop() {
+    profiler.enabled = 0;
+    profile_close(profiler.self_fds);
+    for (int i = 0; i < profiler.num_children; i++) {
+        profile_close(profiler.children[i].fds);
+    }
+    profiler.num_children = 0;
+}
+
+void profile_command(char *args) {
+    while (*args == ' ') args++;
+    if (strcmp(args, "on") == 0) {
+        if (!profiler.enabled && profile_start() < 0) {
+            return;
+        }
+    } else if (strcmp(args, "off") == 0) {
+        profile_stop();
+    } else if (*args != '\0') {
+        printf("Uso: profile [on|off]\n");
+        return;
+    }
+    printf("Perfil %s%s\n", profiler.enabled ? "ligado" : "desligado",
+           profiler.user_only ? " (só espaço de usuário, sem permissão para o kernel)" : "");
+    printf("%-5s %-19s %8s %15s %14s %14s\n", "fase", "contador", "amostras", "média", "p50", "p99");
+    for (int phase = 0; phase < PROF_PHASES; phase++) {
+        for (int c = 0; c < PROF_COUNTERS; c++) {
+            Histogram *h = &profiler.hist[phase][c];
+            uint64_t count = atomic_load_explicit(&h->count, memory_order_relaxed);
+            const char *name = profile_counters[c].name;
+            int width = 19;
+            for (const char *p = name; *p; p++) {
+                width += (*p & 0xC0) == 0x80; // Bytes de continuação do UTF-8 não ocupam coluna
+            }
+            if (!profiler.counter_ok[c]) {
+                printf("%-5s %-*s %8s\n", profile_phase_names[phase], width, name, "n/d");
+                continue;
+            }
+            printf("%-5s %-*s %8llu %14.1f %14llu %14llu\n", profile_phase_names[phase], width, name,
+                   (unsigned long long)count,
+                   count ? (double)atomic_load_explicit(&h->sum_ns, memory_order_relaxed) / count : 0,
+                   (unsigned long long)hist_percentile(h, 0.5), (unsigned long long)hist_percentile(h, 0.99));
+        }
+    }
+}
+
+void render_histogram(FILE *out, const char *name, const char *help, Histogram *h) {
+    fprintf(out, "# HELP %s %s\n# TYPE %s histogram\n", name, help, name);
+    uint64_t cumulative = 0;
+    int i = 0;
+    // Buckets exportados nas potências de 2 entre 1us e ~68s
+    for (int p = 10; p <= 36; p++) {
+        uint64_t le = 1ULL << p;
+        while (i < HIST_BUCKETS && hist_upper(i) <= le) {
+            cumulative += atomic_load_explicit(&h->buckets[i++], memory_order_relaxed);
+        }
+        fprintf(out, "%s_bucket{le=\"%.10g\"} %llu\n", name, le / 1e9, (unsigned long long)cumulative);
+    }
+    uint64_t count = atomic_load_explicit(&h->count, memory_order_relaxed);
+    fprintf(out, "%s_bucket{le=\"+Inf\"} %llu\n", name, (unsigned long long)count);
+    fprintf(out, "%s_sum %.9f\n", name, atomic_load_explicit(&h->sum_ns, memory_order_relaxed) / 1e9);
+    fprintf(out, "%s_count %llu\n", name, (unsigned long long)count);
+}
+
+// Formato texto do Prometheus
+void render_metrics(FILE *out) {
+    fprintf(out, "# HELP fsh_spawns_total Processos criados pela shell.\n# TYPE fsh_spawns_total counter\n");
+    fprintf(out, "fsh_spawns_total %llu\n", (unsigned long long)atomic_load(&metrics->spawns));
+    fprintf(out, "# HELP fsh_spawn_failures_total Falhas de fork.\n# TYPE fsh_spawn_failures_total counter\n");
+    fprintf(out, "fsh_spawn_failures_total %llu\n", (unsigned long long)atomic_load(&metrics->spawn_failures));
+    fprintf(out, "# HELP fsh_reaps_total Processos filhos reapados.\n# TYPE fsh_reaps_total counter\n");
+    fprintf(out, "fsh_reaps_total %llu\n", (unsigned long long)atomic_load(&metrics->reaps));
+    fprintf(out, "# HELP fsh_signals_forwarded_total Sinais repassados a grupos de processos.\n# TYPE fsh_signals_forwarded_total counter\n");
+    fprintf(out, "fsh_signals_forwarded_total %llu\n", (unsigned long long)atomic_load(&metrics->signals_forwarded));
+    fprintf(out, "# HELP fsh_active_jobs Processos filhos em execução.\n# TYPE fsh_active_jobs gauge\n");
+    fprintf(out, "fsh_active_jobs %lld\n", (long long)atomic_load(&metrics->active_jobs));
+    render_histogram(out, "fsh_spawn_to_exec_seconds", "Latência entre fork e exec concluído.", &metrics->spawn_to_exec);
+    render_histogram(out, "fsh_exit_to_reap_seconds", "Latência entre SIGCHLD e o reap do filho.", &metrics->exit_to_reap);
+}
+
+// Processo exportador: reescreve $FSH_METRICS_FILE (via arquivo temporário e
+// rename, como espera o textfile collector do node_exporter) a cada
+// $FSH_METRICS_INTERVAL ms. É desacoplado da shell por um fork duplo, para
+// não aparecer em waitall, e termina quando a ponta de escrita do pipe de
+// vida, mantida pela shell, é fechada.
+void start_metrics_exporter() {
+    const char *path = getenv("FSH_METRICS_FILE");
+    if (path == NULL) {
+        return;
+    }
+    const char *interval_env = getenv("FSH_METRICS_INTERVAL");
+    int interval_ms = interval_env ? atoi(interval_env) : 1000;
+    if (interval_ms < 10) interval_ms = 10;
+
+    int lifeline[2];
+    if (pipe2(lifeline, O_CLOEXEC) < 0) {
+        perror("Erro ao criar pipe do exportador de métricas");
+        return;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("Erro no fork do exportador de métricas");
+        close(lifeline[0]);
+        close(lifeline[1]);
+        return;
+    }
+    if (pid == 0) {
+        if (fork() != 0) {
+            _exit(0);
+        }
+        setsid();
+        signal(SIGINT, SIG_IGN);
+        signal(SIGTSTP, SIG_IGN);
+        close(lifeline[1]);
+
+        char tmp[MAX_BUFFER + 8];
+        snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+        while (1) {
+            FILE *out = fopen(tmp, "w");
+            if (out != NULL) {
+                render_metrics(out);
+                fclose(out);
+                rename(tmp, path);
+            }
+            struct pollfd pfd = { .fd = lifeline[0], .events = POLLIN };
+            if (poll(&pfd, 1, interval_ms) > 0) {
+                _exit(0); // A shell terminou
+            }
+        }
+    }
+    close(lifeline[0]);
+    waitpid(pid, NULL, 0);
+}
+
+// Interfaces estáticas das estratégias de compilação
+
+// Coloca o processo atual em um novo grupo, se a política de sinais usar grupos
+static inline void join_process_group(pid_t pgid) {
+#if FSH_SIGNALS == FSH_SIGNALS_GROUP
+    if (setpgid(0, pgid) < 0 && pgid != 0) {
+        setpgid(0, 0); // O grupo do job já acabou: começar um novo
+    }
+#else
+    (void)pgid;
+#endif
+}
+
+// Envia um sinal ao job: ao grupo inteiro ou só ao processo
+static inline int signal_job(pid_t pid, int sig) {
+#if FSH_SIGNALS == FSH_SIGNALS_GROUP
+    return kill(-pid, sig);
+#else
+    return kill(pid, sig);
+#endif
+}
+
+// Grupo de um job que chamou join_process_group(0): ele mesmo é o líder
+static inline pid_t job_pgid(pid_t pid) {
+#if FSH_SIGNALS == FSH_SIGNALS_GROUP
+    return pid;
+#else
+    (void)pid;
+    return 0; // Sem grupo próprio
+#endif
+}
+
+#if FSH_LAUNCHER == FSH_LAUNCH_EXECVP
+// Separa o comando em argumentos, no próprio buffer
+int parse_args(char *command, char **args, int max_args) {
+    int count = 0;
+#if FSH_PARSER == FSH_PARSE_SPACES
+    char *save;
+    for (char *token = strtok_r(command, " \t", &save); token && count < max_args; token = strtok_r(NULL, " \t", &save)) {
+        args[count++] = token;
+    }
+#else
+    char *src = command, *dst = command;
+    while (*src != '\0' && count < max_args) {
+        while (*src == ' ' || *src == '\t') src++;
+        if (*src == '\0') {
+            break;
+        }
+        args[count++] = dst;
+        char quote = 0;
+        while (*src != '\0' && (quote || (*src != ' ' && *src != '\t'))) {
+            if (quote && *src == quote) {
+                quote = 0;
+            } else if (!quote && (*src == '\'' || *src == '"')) {
+                quote = *src;
+            } else {
+                *dst++ = *src;
+            }
+            src++;
+        }
+        if (*src != '\0') {
+            src++;
+        }
+        *dst++ = '\0';
+    }
+#endif
+    args[count] = NULL;
+    return count;
+}
+#endif
+
+// Substitui o processo atual pelo comando; só retorna se o exec falhar.
+// envp NULL mantém o ambiente da shell.
+static inline void launcher_exec(char *command, char **envp) {
+    if (envp == NULL) {
+        envp = environ;
+    }
+#if FSH_LAUNCHER == FSH_LAUNCH_EXECVP
+    if (!is_compound_line(command)) { // if, for, ( ) e afins só o sh entende
+        char *args[MAX_ARGS + 1];
+        if (parse_args(command, args, MAX_ARGS) == 0) {
+            errno = ENOENT;
+            return;
+        }
+        execvpe(args[0], args, envp);
+        return;
+    }
+#endif
+    char *args[] = { "/bin/sh", "-c", command, NULL };
+    execve(args[0], args, envp);
+}
+
+void propagate_signal_to_group(ProcessGroup *group, int sig) {
+#if FSH_SIGNALS == FSH_SIGNALS_GROUP
+    if (group->pgid > 0) { // Um único killpg para a linha inteira
+        if (killpg(group->pgid, sig) == 0) {
+            atomic_fetch_add_explicit(&metrics->signals_forwarded, 1, memory_order_relaxed);
+        }
+        return;
+    }
+#endif
+    for (int i = 0; i < group->count; i++) {
+        if (group->pids[i] != 0) {
+            if (signal_job(group->pids[i], sig) == 0) { // Enviar sinal para o grupo de processos
+                atomic_fetch_add_explicit(&metrics->signals_forwarded, 1, memory_order_relaxed);
+            }
+        }
+    }
+}
+
+void handle_sigint(int sig) {
+    (void)sig; // Marcar o parâmetro como utilizado para evitar avisos
+    printf("\nRecebido SIGINT\n");
+
+    if (num_bg_process_groups > 0 || fg_process_pid != 0 || dag_run.active || admission_len > 0) {
+        printf("Você tem certeza que deseja finalizar a shell? (y/n): ");
+        char c = getchar();
+        session_event(SESSION_SIGINT, (unsigned char)c, 0, 0, NULL, 0);
+        if (c == 'y' || c == 'Y') {
+            printf("Finalizando shell...\n");
+#if FSH_SIGINT_KILLS_JOBS
+            terminate_all_processes();
+#endif
+            exit(0);
+        } else {
+            printf("Continuando shell...\n");
+            while (getchar() != '\n');
+        }
+    } else {
+        session_event(SESSION_SIGINT, 0, 0, 0, NULL, 0);
+        printf("Finalizando shell...\n");
+        exit(0);
+    }
+    printf("fsh> "); // Imprimir prompt após manipulação de SIGINT
+    fflush(stdout);
+}
+
+void handle_sigtstp(int sig) {
+    (void)sig; // Marcar o parâmetro como utilizado para evitar avisos
+    printf("\nRecebido SIGTSTP, suspendendo processos...\n");
+    session_event(SESSION_SIGTSTP, 0, 0, 0, NULL, 0);
+
+    if (fg_process_pid != 0) {
+        signal_job(fg_process_pid, FSH_STOP_SIGNAL); // Enviar sinal para o grupo de processos
+    }
+    fg_stop_requested = 1;
+
+    for (int i = 0; i < num_bg_process_groups; i++) {
+        propagate_signal_to_group(&bg_process_groups[i], FSH_STOP_SIGNAL);
+        bg_process_groups[i].stopped = 1;
+    }
+    dag_run.stopped = dag_run.active; // Os jobs do DAG são grupos em background, já parados acima
+    sleep(1);
+    printf("fsh> "); // Imprimir prompt após manipulação de SIGTSTP
+    fflush(stdout);
+}
+
+int64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Gravação da sessão (formato em session.h). Cada evento é um único write,
+// sem buffer do stdio, para poder ser gravado de dentro dos tratadores de
+// sinal e não se perder se a shell morrer.
+void session_event(int type, int answer, pid_t pid, int status, const char *data, size_t len) {
+    if (session_fd < 0) {
+        return;
+    }
+    SessionEvent ev = {
+        .t_ns = mono_ns() - session_start_ns, .type = type, .answer = answer,
+        .len = len, .pid = pid, .status = status,
+    };
+    struct iovec iov[2] = { { &ev, sizeof(ev) }, { (void *)data, len } };
+    if (writev(session_fd, iov, len > 0 ? 2 : 1) < 0) {
+        int saved = errno;
+        close(session_fd);
+        session_fd = -1;
+        errno = saved;
+        perror("Erro ao gravar a sessão");
+    }
+}
+
+int session_open(const char *path) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        perror("Erro ao abrir o arquivo da sessão");
+        return -1;
+    }
+    SessionHeader header = { .magic = SESSION_MAGIC, .start_ns = now_ns() };
+    if (write(fd, &header, sizeof(header)) != sizeof(header)) {
+        perror("Erro ao gravar a sessão");
+        close(fd);
+        return -1;
+    }
+    if (session_fd >= 0) {
+        close(session_fd);
+    }
+    session_start_ns = mono_ns();
+    session_fd = fd;
+    return 0;
+}
+
+void record_command(char *args) {
+    while (*args == ' ') args++;
+    if (strcmp(args, "off") == 0) {
+        if (session_fd >= 0) {
+            close(session_fd);
+            session_fd = -1;
+        }
+        printf("Gravação da sessão encerrada\n");
+    } else if (*args != '\0') {
+        if (session_open(args) == 0) {
+            printf("Gravando a sessão em %s\n", args);
+        }
+    } else {
+        printf("Uso: record arquivo|off (gravação %s)\n", session_fd >= 0 ? "ativa" : "inativa");
+    }
+}
+
+// Quadro de jobs em memória compartilhada (formato em board.h). A cada volta
+// do loop principal os grupos são copiados para os registros, escrevendo só
+// os que mudaram; a CPU dos processos vivos vem do /proc no máximo uma vez
+// por BOARD_CPU_INTERVAL_NS. Um grupo que sai da tabela fica no quadro como
+// terminado por BOARD_LINGER_NS, para que os monitores vejam o fim dele.
+int board_open(const char *path) {
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        perror("Erro ao abrir o quadro de jobs");
+        return -1;
+    }
+    size_t size = sizeof(BoardHeader) + BOARD_SLOTS * sizeof(BoardRecord);
+    if (ftruncate(fd, size) < 0) {
+        perror("Erro ao dimensionar o quadro de jobs");
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("Erro ao mapear o quadro de jobs");
+        return -1;
+    }
+    if (board != NULL) {
+        munmap(board, sizeof(BoardHeader) + BOARD_SLOTS * sizeof(BoardRecord));
+    }
+    board = map; // Zerado pelo ftruncate: todas as posições livres
+    board->shell_pid = getpid();
+    board->slots = BOARD_SLOTS;
+    board->record_size = sizeof(BoardRecord);
+    memcpy(board->magic, BOARD_MAGIC, 8);
+    board_cpu_sampled_ns = 0;
+    return 0;
+}
+
+void board_close() {
+    if (board != NULL) {
+        munmap(board, sizeof(BoardHeader) + BOARD_SLOTS * sizeof(BoardRecord));
+        board = NULL;
+    }
+}
+
+static inline BoardRecord *board_records() {
+    return (BoardRecord *)(board + 1);
+}
+
+// Escrita sob o seqlock: seq ímpar durante a cópia
+void board_write(BoardRecord *slot, const BoardRecord *rec) {
+    uint32_t seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+    atomic_store_explicit(&slot->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy((char *)slot + sizeof(slot->seq), (const char *)rec + sizeof(rec->seq), sizeof(*rec) - sizeof(rec->seq));
+    atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);
+}
+
+int board_changed(const BoardRecord *slot, const BoardRecord *rec) {
+    return memcmp((const char *)slot + sizeof(slot->seq), (const char *)rec + sizeof(rec->seq),
+                  sizeof(*rec) - sizeof(rec->seq)) != 0;
+}
+
+int64_t rusage_cpu_ns(const struct rusage *ru) {
+    return (ru->ru_utime.tv_sec + ru->ru_stime.tv_sec) * 1000000000LL +
+           (ru->ru_utime.tv_usec + ru->ru_stime.tv_usec) * 1000LL;
+}
+
+// CPU dos processos vivos de cada grupo, em uma passada pelo /proc. Conta
+// todo processo no grupo de processos do job (o comando costuma rodar em um
+// neto da shell, filho do /bin/sh -c) e, de cada um, também os filhos que ele
+// já esperou (cutime e cstime). Sem grupo próprio (FSH_SIGNALS_PROCESS),
+// só os PIDs do grupo.
+void board_scan_cpu(int64_t *cpu) {
+    memset(cpu, 0, num_bg_process_groups * sizeof(int64_t));
+    DIR *dir = opendir("/proc");
+    if (dir == NULL) {
+        return;
+    }
+    int64_t tick_ns = 1000000000LL / sysconf(_SC_CLK_TCK);
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] < '0' || entry->d_name[0] > '9') {
+            continue;
+        }
+        char path[300], buf[512];
+        snprintf(path, sizeof(path), "/proc/%s/stat", entry->d_name);
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        ssize_t n = read(fd, buf, sizeof(buf) - 1);
+        close(fd);
+        if (n <= 0) {
+            continue;
+        }
+        buf[n] = '\0';
+        char *p = strrchr(buf, ')'); // O nome do comando pode ter espaços
+        int pgrp;
+        unsigned long utime, stime;
+        long cutime, cstime;
+        if (p == NULL || sscanf(p + 2, "%*c %*d %d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu %ld %ld", &pgrp, &utime,
+                                &stime, &cutime, &cstime) != 5) {
+            continue;
+        }
+        pid_t pid = atoi(entry->d_name);
+        for (int i = 0; i < num_bg_process_groups; i++) {
+            ProcessGroup *group = &bg_process_groups[i];
+            int member = group->pgid > 0 && pgrp == group->pgid;
+            for (int j = 0; group->pgid <= 0 && j < group->count && !member; j++) {
+                member = group->pids[j] == pid;
+            }
+            if (member) {
+                cpu[i] += (int64_t)(utime + stime + cutime + cstime) * tick_ns;
+                break;
+            }
+        }
+    }
+    closedir(dir);
+}
+
+int board_slot_of(int id) {
+    BoardRecord *records = board_records();
+    int free_slot = -1;
+    for (int i = 0; i < BOARD_SLOTS; i++) {
+        if (records[i].state != BOARD_FREE && records[i].id == id) {
+            return i;
+        }
+        if (free_slot < 0 && records[i].state == BOARD_FREE) {
+            free_slot = i;
+        }
+    }
+    return free_slot; // -1: quadro cheio
+}
+
+// live_cpu: CPU dos processos vivos do grupo, ou -1 para manter a última amostra
+void board_fill(BoardRecord *rec, ProcessGroup *group, const BoardRecord *previous, int64_t live_cpu) {
+    memset(rec, 0, sizeof(*rec));
+    rec->state = group->stopped || group->paused_seq || group->gang_paused ? BOARD_STOPPED : BOARD_RUNNING;
+    rec->id = group->id;
+    rec->pgid = group->pgid;
+    rec->started_ns = group->count > 0 ? group->started_ns[0] : 0;
+    rec->count = group->reaped;
+    rec->failed = group->failed;
+    rec->cpu_ns = group->cpu_ns;
+    for (int j = 0; j < group->count && j < BOARD_PIDS; j++) {
+        rec->pids[j] = group->pids[j];
+        rec->live += group->pids[j] != 0;
+    }
+    rec->count += rec->live;
+    rec->num_pids = group->count < BOARD_PIDS ? group->count : BOARD_PIDS;
+    if (live_cpu >= 0) {
+        rec->cpu_ns += live_cpu;
+    } else if (previous->id == group->id && previous->cpu_ns > rec->cpu_ns) {
+        rec->cpu_ns = previous->cpu_ns; // Até a próxima amostragem
+    }
+    snprintf(rec->label, sizeof(rec->label), "%s", group->label);
+    snprintf(rec->name, sizeof(rec->name), "%s", group->count > 0 ? group->names[0] : "");
+}
+
+// Chamado quando o grupo sai da tabela: o registro fica com os valores finais
+void board_group_done(ProcessGroup *group) {
+    if (board == NULL) {
+        return;
+    }
+    int slot = board_slot_of(group->id);
+    if (slot < 0) {
+        return;
+    }
+    BoardRecord *records = board_records();
+    BoardRecord rec;
+    board_fill(&rec, group, &records[slot], 0);
+    rec.state = BOARD_EXITED;
+    board_write(&records[slot], &rec);
+    board_exited_ns[slot] = mono_ns();
+}
+
+void board_update() {
+    if (board == NULL) {
+        return;
+    }
+    int64_t now = mono_ns();
+    int sample_cpu = now - board_cpu_sampled_ns >= BOARD_CPU_INTERVAL_NS;
+    int64_t cpu[MAX_PROCESSES];
+    if (sample_cpu) {
+        board_cpu_sampled_ns = now;
+        board_scan_cpu(cpu);
+    }
+    BoardRecord *records = board_records();
+    char seen[BOARD_SLOTS] = { 0 };
+    for (int i = 0; i < num_bg_process_groups; i++) {
+        int slot = board_slot_of(bg_process_groups[i].id);
+        if (slot < 0) {
+            continue;
+        }
+        BoardRecord rec;
+        board_fill(&rec, &bg_process_groups[i], &records[slot], sample_cpu ? cpu[i] : -1);
+        if (board_changed(&records[slot], &rec)) {
+            board_write(&records[slot], &rec);
+        }
+        seen[slot] = 1;
+    }
+    for (int i = 0; i < BOARD_SLOTS; i++) {
+        if (seen[i] || records[i].state == BOARD_FREE) {
+            continue;
+        }
+        BoardRecord rec = records[i];
+        if (rec.state != BOARD_EXITED) { // Saiu da tabela por outro caminho (fg)
+            rec.state = BOARD_EXITED;
+            rec.live = 0;
+            memset(rec.pids, 0, sizeof(rec.pids));
+            board_write(&records[i], &rec);
+            board_exited_ns[i] = now;
+        } else if (now - board_exited_ns[i] >= BOARD_LINGER_NS) {
+            memset(&rec, 0, sizeof(rec));
+            board_write(&records[i], &rec);
+        }
+    }
+    atomic_store_explicit(&board->updated_ns, now_ns(), memory_order_release);
+}
+
+// board arquivo|off
+void board_command(char *args) {
+    while (*args == ' ') args++;
+    if (strcmp(args, "off") == 0) {
+        board_close();
+        printf("Quadro de jobs desligado\n");
+    } else if (*args != '\0') {
+        if (board_open(args) == 0) {
+            board_update();
+            printf("Quadro de jobs em %s\n", args);
+        }
+    } else {
+        printf("Uso: board arquivo|off (quadro %s)\n", board != NULL ? "ativo" : "inativo");
+    }
+}
+
+// Avisos da shell sobre os jobs ("iniciado", "terminou"). Em vez de um printf
+// por processo, os avisos vão para um buffer escrito com um único write por
+// volta do loop principal. Acima de NOTIFY_BURST avisos em uma janela de
+// NOTIFY_WINDOW_NS eles deixam de sair um a um e viram um resumo no fim da
+// janela. Opcionalmente os mesmos eventos saem, todos e em JSON por linha,
+// em outro descritor (FSH_EVENT_FD ou builtin events).
+void notify_append(char *buf, size_t *len, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf + *len, NOTIFY_BUF_LEN - *len, fmt, ap);
+    va_end(ap);
+    if (n > 0) {
+        *len += (size_t)n < NOTIFY_BUF_LEN - *len ? (size_t)n : NOTIFY_BUF_LEN - 1 - *len;
+    }
+}
+
+void write_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        buf += n;
+        len -= n;
+    }
+}
+
+// Fecha a janela de limite de taxa, resumindo o que foi suprimido
+void notify_window() {
+    int64_t now = mono_ns();
+    if (now - notifier.window_ns < NOTIFY_WINDOW_NS) {
+        return;
+    }
+    if (notifier.started > 0 || notifier.finished > 0) {
+        notify_append(notifier.buf, &notifier.len,
+                      "%d jobs iniciados, %d terminaram (%d falharam) em %.1fs\n",
+                      notifier.started, notifier.finished, notifier.failed,
+                      (now - notifier.window_ns) / 1e9);
+    }
+    notifier.window_ns = now;
+    notifier.shown = notifier.started = notifier.finished = notifier.failed = 0;
+}
+
+void notify_flush() {
+    notify_window();
+    if (notifier.len > 0) {
+        fflush(stdout); // O que já foi impresso com printf vem antes
+        if (!notifier.quiet) {
+            write_all(STDOUT_FILENO, notifier.buf, notifier.len);
+        }
+        notifier.len = 0;
+    }
+    if (notifier.events_len > 0) {
+        write_all(notifier.event_fd, notifier.events, notifier.events_len);
+        notifier.events_len = 0;
+    }
+}
+
+// Garante espaço no buffer para mais um aviso
+void notify_reserve() {
+    notify_window();
+    if (notifier.len > NOTIFY_BUF_LEN - 512 || notifier.events_len > NOTIFY_BUF_LEN - 512) {
+        notify_flush();
+    }
+}
+
+// Reserva espaço para mais um aviso de job; retorna 0 se ele deve ser suprimido
+int notify_slot() {
+    notify_reserve();
+    return notifier.shown++ < NOTIFY_BURST;
+}
+
+void json_string(char *buf, size_t *len, const char *s) {
+    notify_append(buf, len, "\"");
+    for (; *s && *len < NOTIFY_BUF_LEN - 8; s++) {
+        unsigned char c = *s;
+        if (c == '"' || c == '\\') {
+            notify_append(buf, len, "\\%c", c);
+        } else if (c < 0x20) {
+            notify_append(buf, len, "\\u%04x", c);
+        } else {
+            buf[(*len)++] = c;
+        }
+    }
+    notify_append(buf, len, "\"");
+}
+
+void notify_started(int group_id, pid_t pid, const char *command, int secondary) {
+    if (notify_slot()) {
+        if (secondary) {
+            notify_append(notifier.buf, &notifier.len, "Processo secundário '%s' iniciado (PID=%d)\n", command, pid);
+        } else {
+            notify_append(notifier.buf, &notifier.len, "Processo '%s' iniciado em background (PID=%d)\n", command, pid);
+        }
+    } else {
+        notifier.started++;
+    }
+    if (notifier.event_fd >= 0) {
+        notify_append(notifier.events, &notifier.events_len,
+                      "{\"ts\":%lld,\"event\":\"start\",\"job\":%d,\"pid\":%d,\"secondary\":%s,\"command\":",
+                      (long long)now_ns(), group_id, pid, secondary ? "true" : "false");
+        json_string(notifier.events, &notifier.events_len, command);
+        notify_append(notifier.events, &notifier.events_len, "}\n");
+    }
+}
+
+void notify_finished(int group_id, pid_t pid, int status) {
+    int failed = !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    if (notify_slot()) {
+        notify_append(notifier.buf, &notifier.len, "Processo em background (PID=%d) terminou\n", pid);
+    } else {
+        notifier.finished++;
+        notifier.failed += failed;
+    }
+    if (notifier.event_fd >= 0) {
+        notify_append(notifier.events, &notifier.events_len,
+                      "{\"ts\":%lld,\"event\":\"exit\",\"job\":%d,\"pid\":%d,",
+                      (long long)now_ns(), group_id, pid);
+        if (WIFSIGNALED(status)) {
+            notify_append(notifier.events, &notifier.events_len, "\"signal\":%d}\n", WTERMSIG(status));
+        } else {
+            notify_append(notifier.events, &notifier.events_len, "\"code\":%d}\n", WEXITSTATUS(status));
+        }
+    }
+}
+
+// Aviso avulso, sem limite de taxa e sem gastar a cota dos avisos de job
+void notify_text(const char *fmt, ...) {
+    notify_reserve();
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(notifier.buf + notifier.len, NOTIFY_BUF_LEN - notifier.len, fmt, ap);
+    va_end(ap);
+    if (n > 0) {
+        notifier.len += (size_t)n < NOTIFY_BUF_LEN - notifier.len ? (size_t)n : NOTIFY_BUF_LEN - 1 - notifier.len;
+    }
+}
+
+void events_command(char *args) {
+    while (*args == ' ') args++;
+    if (strcmp(args, "off") == 0) {
+        notify_flush();
+        notifier.event_fd = -1;
+    } else if (*args != '\0') {
+        char *end;
+        long fd = strtol(args, &end, 10);
+        if (*end != '\0' || fd < 0 || fcntl((int)fd, F_GETFD) < 0) {
+            printf("Uso: events FD|off (o descritor precisa estar aberto)\n");
+            return;
+        }
+        notify_flush();
+        notifier.event_fd = (int)fd;
+    }
+    if (notifier.event_fd >= 0) {
+        printf("Eventos em JSON no descritor %d\n", notifier.event_fd);
+    } else {
+        printf("Eventos em JSON desligados\n");
+    }
+}
+
+// Hash FNV-1a de 64 bits do comando
+uint64_t hash_command(const char *command) {
+    uint64_t h = 1469598103934665603ULL;
+    for (; *command; command++) {
+        h ^= (unsigned char)*command;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// Registra o processo no grupo e retorna a posição dele (-1 se não couber).
+// Arrays reaproveitam as posições dos processos que já terminaram.
+int track_process(ProcessGroup *group, pid_t pid, const char *command) {
+    int i = group->count;
+    for (int j = 0; group->array != 0 && j < group->count; j++) {
+        if (group->pids[j] == 0) {
+            i = j;
+            break;
+        }
+    }
+    if (i >= MAX_PROCESSES) {
+        return -1;
+    }
+    if (i == group->count) {
+        group->count++;
+    }
+    group->pids[i] = pid;
+    group->started_ns[i] = now_ns();
+    group->hashes[i] = hash_command(command);
+    snprintf(group->names[i], JOB_NAME_LEN, "%s", command);
+    group->cpus[i][0] = '\0';
+    group->nodes[i] = -2;
+    group->timers[i] = -1;
+    session_event(SESSION_JOB_START, 0, pid, 0, NULL, 0);
+    return i;
+}
+
+int group_live(ProcessGroup *group) {
+    int live = 0;
+    for (int j = 0; j < group->count; j++) {
+        live += group->pids[j] != 0;
+    }
+    return live;
+}
+
+int group_slot(ProcessGroup *group, pid_t pid) {
+    for (int j = 0; j < group->count; j++) {
+        if (group->pids[j] == pid) {
+            return j;
+        }
+    }
+    return -1;
+}
+
+// Abre (ou cria) o log de histórico e mapeia o arquivo inteiro de uma vez.
+// O arquivo é criado esparso com o tamanho máximo, de modo que gravar um
+// registro é só uma cópia em memória, sem nenhuma chamada de sistema. O log
+// só é mantido com FSH_JOB_LOG=arquivo: sem ele nada é criado no disco e a
+// partida (inclusive a de fsh -c) não paga open, ftruncate e mmap.
+void job_log_open() {
+    const char *path = getenv("FSH_JOB_LOG");
+    if (path == NULL || *path == '\0') {
+        return;
+    }
+    snprintf(job_log_path, sizeof(job_log_path), "%s", path);
+    const char *max = getenv("FSH_JOB_LOG_MAX");
+    if (max != NULL && atol(max) >= (long)(2 * sizeof(JobRecord))) {
+        job_log_max = atol(max);
+    }
+
+    int fd = open(job_log_path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        perror("Erro ao abrir o log de jobs");
+        return;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        perror("Erro ao abrir o log de jobs");
+        close(fd);
+        return;
+    }
+    int fresh = st.st_size == 0;
+    size_t size = fresh ? (size_t)job_log_max / sizeof(JobRecord) * sizeof(JobRecord) : (size_t)st.st_size;
+    if (fresh && ftruncate(fd, size) < 0) {
+        perror("Erro ao dimensionar o log de jobs");
+        close(fd);
+        return;
+    }
+    if (size < 2 * sizeof(JobRecord)) {
+        fprintf(stderr, "Arquivo '%s' não é um log de jobs válido\n", job_log_path);
+        close(fd);
+        return;
+    }
+
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("Erro ao mapear o log de jobs");
+        return;
+    }
+
+    JobLogHeader *header = map;
+    if (fresh) {
+        memcpy(header->magic, "FSHJLOG1", 8);
+        header->count = 0;
+        header->capacity = size / sizeof(JobRecord) - 1;
+    } else if (memcmp(header->magic, "FSHJLOG1", 8) != 0 || header->capacity >= size / sizeof(JobRecord) ||
+               header->count > header->capacity) {
+        // Capacidade além do fim do arquivo (truncado ou de outro programa)
+        // daria SIGBUS na primeira gravação
+        fprintf(stderr, "Arquivo '%s' não é um log de jobs válido\n", job_log_path);
+        munmap(map, size);
+        return;
+    }
+    job_log = header;
+    job_log_size = size;
+}
+
+// Renomeia o log cheio para <log>.1 (descartando a rotação anterior). Se o
+// rename falhar, o log segue cheio e a próxima gravação tenta de novo; se
+// só a reabertura falhar, ela é repetida a cada gravação.
+void rotate_job_log() {
+    char old_path[MAX_BUFFER + 2];
+    snprintf(old_path, sizeof(old_path), "%s.1", job_log_path);
+    if (rename(job_log_path, old_path) < 0) {
+        perror("Erro ao rotacionar o log de jobs");
+        return;
+    }
+    munmap(job_log, job_log_size);
+    job_log = NULL;
+    job_log_open();
+    job_log_retry = job_log == NULL;
+    if (job_log_retry) {
+        fprintf(stderr, "Log de jobs indisponível; nova tentativa no próximo job\n");
+    }
+}
+
+void log_finished_job(pid_t pid, pid_t pgid, uint64_t hash, const char *name, int64_t started_ns, int status, struct rusage *ru) {
+    session_event(SESSION_JOB_END, 0, pid, status, NULL, 0);
+    profile_reaped(pid);
+    if (job_log == NULL && job_log_retry) {
+        job_log_open();
+        job_log_retry = job_log == NULL;
+    }
+    if (job_log == NULL) {
+        return;
+    }
+    if (job_log->count >= job_log->capacity) {
+        rotate_job_log();
+        if (job_log == NULL || job_log->count >= job_log->capacity) {
+            return; // Registro perdido; o erro já foi informado
+        }
+    }
+
+    JobRecord *rec = (JobRecord *)job_log + 1 + job_log->count;
+    rec->argv_hash = hash;
+    rec->pgid = pgid;
+    rec->status = status;
+    rec->start_ns = started_ns;
+    rec->end_ns = now_ns();
+    rec->utime_us = ru->ru_utime.tv_sec * 1000000LL + ru->ru_utime.tv_usec;
+    rec->stime_us = ru->ru_stime.tv_sec * 1000000LL + ru->ru_stime.tv_usec;
+    rec->maxrss_kb = ru->ru_maxrss;
+    rec->minflt = ru->ru_minflt;
+    rec->majflt = ru->ru_majflt;
+    rec->nvcsw = ru->ru_nvcsw;
+    rec->nivcsw = ru->ru_nivcsw;
+    strncpy(rec->command, name, JOB_NAME_LEN - 1);
+    rec->command[JOB_NAME_LEN - 1] = '\0';
+    job_log->count++; // Publicar o registro só depois de preenchido
+}
+
+// Percorre um arquivo de log de trás para frente, coletando até 'limit'
+// registros com fim em [from_ns, to_ns]. Os registros estão ordenados pelo
+// instante de término, então o intervalo é localizado por busca binária.
+int query_job_log_file(const char *path, int64_t from_ns, int64_t to_ns, uint64_t hash,
+                       JobRecord *out, int found, int limit) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return found;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)(2 * sizeof(JobRecord))) {
+        close(fd);
+        return found;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return found;
+    }
+
+    const JobLogHeader *header = map;
+    const JobRecord *recs = (const JobRecord *)map + 1;
+    if (memcmp(header->magic, "FSHJLOG1", 8) == 0 && header->count < (uint64_t)st.st_size / sizeof(JobRecord)) {
+        uint64_t lo = 0, hi = header->count;
+        while (lo < hi) { // Primeiro registro com fim depois de to_ns
+            uint64_t mid = lo + (hi - lo) / 2;
+            if (recs[mid].end_ns <= to_ns) lo = mid + 1; else hi = mid;
+        }
+        for (uint64_t i = lo; i > 0 && found < limit; i--) {
+            const JobRecord *rec = &recs[i - 1];
+            if (rec->end_ns < from_ns) {
+                break;
+            }
+            if (hash == 0 || rec->argv_hash == hash) {
+                out[found++] = *rec;
+            }
+        }
+    }
+    munmap(map, st.st_size);
+    return found;
+}
+
+// history-jobs [-s inicio] [-e fim] [-c comando] [-n max]
+// Instantes em segundos desde a época; valores negativos são relativos a agora.
+void history_jobs(char *args) {
+    if (job_log_path[0] == '\0') {
+        printf("Log de jobs desligado (defina FSH_JOB_LOG=arquivo antes de iniciar a shell)\n");
+        return;
+    }
+    int64_t now = now_ns();
+    int64_t from_ns = 0, to_ns = INT64_MAX;
+    uint64_t hash = 0;
+    int limit = 20;
+
+    char *save;
+    for (char *arg = strtok_r(args, " ", &save); arg; arg = strtok_r(NULL, " ", &save)) {
+        if (strcmp(arg, "-c") == 0) {
+            char *rest = strtok_r(NULL, "", &save); // O comando vai até o fim da linha
+            if (rest != NULL) {
+                hash = hash_command(rest);
+            }
+            break;
+        }
+        char *value = strtok_r(NULL, " ", &save);
+        if (value == NULL) {
+            printf("Uso: history-jobs [-s inicio] [-e fim] [-n max] [-c comando]\n");
+            return;
+        }
+        long long v = atoll(value);
+        int64_t t = v < 0 ? now + v * 1000000000LL : v * 1000000000LL;
+        if (strcmp(arg, "-s") == 0) {
+            from_ns = t;
+        } else if (strcmp(arg, "-e") == 0) {
+            to_ns = t;
+        } else if (strcmp(arg, "-n") == 0 && v > 0) {
+            limit = (int)v;
+        } else {
+            printf("Uso: history-jobs [-s inicio] [-e fim] [-n max] [-c comando]\n");
+            return;
+        }
+    }
+
+    JobRecord *found_recs = malloc(sizeof(JobRecord) * limit);
+    if (found_recs == NULL) {
+        perror("Erro ao alocar memória");
+        return;
+    }
+    char old_path[MAX_BUFFER + 2];
+    snprintf(old_path, sizeof(old_path), "%s.1", job_log_path);
+    int found = query_job_log_file(job_log_path, from_ns, to_ns, hash, found_recs, 0, limit);
+    found = query_job_log_file(old_path, from_ns, to_ns, hash, found_recs, found, limit);
+
+    printf("%-19s %9s %7s %-8s %9s %8s  %s\n", "FIM", "DURAÇÃO", "PGID", "STATUS", "CPU(s)", "RSS(KB)", "COMANDO");
+    for (int i = found - 1; i >= 0; i--) {
+        JobRecord *rec = &found_recs[i];
+        time_t end = rec->end_ns / 1000000000LL;
+        struct tm tm;
+        char when[32], st[16];
+        strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime_r(&end, &tm));
+        if (WIFSIGNALED(rec->status)) {
+            snprintf(st, sizeof(st), "sig %d", WTERMSIG(rec->status));
+        } else {
+            snprintf(st, sizeof(st), "exit %d", WEXITSTATUS(rec->status));
+        }
+        printf("%-19s %8.3fs %7d %-8s %9.3f %8lld  %s\n", when,
+               (rec->end_ns - rec->start_ns) / 1e9, rec->pgid, st,
+               (rec->utime_us + rec->stime_us) / 1e6, (long long)rec->maxrss_kb, rec->command);
+    }
+    free(found_recs);
+}
+
+// Lê uma lista de CPUs no formato do kernel ("0-3,8,10-11")
+int parse_cpulist(const char *list, cpu_set_t *set) {
+    CPU_ZERO(set);
+    while (*list != '\0' && *list != '\n') {
+        char *end;
+        long first = strtol(list, &end, 10);
+        long last = first;
+        if (end == list) {
+            return -1;
+        }
+        if (*end == '-') {
+            list = end + 1;
+            last = strtol(list, &end, 10);
+            if (end == list) {
+                return -1;
+            }
+        }
+        for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+            CPU_SET(cpu, set);
+        }
+        list = *end == ',' ? end + 1 : end;
+    }
+    return CPU_COUNT(set) > 0 ? 0 : -1;
+}
+
+void format_cpulist(const cpu_set_t *set, char *out, size_t size) {
+    size_t len = 0;
+    out[0] = '\0';
+    for (int cpu = 0; cpu < CPU_SETSIZE && len < size; cpu++) {
+        if (!CPU_ISSET(cpu, set)) {
+            continue;
+        }
+        int last = cpu;
+        while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, set)) last++;
+        if (last == cpu) {
+            len += snprintf(out + len, size - len, "%s%d", len ? "," : "", cpu);
+        } else {
+            len += snprintf(out + len, size - len, "%s%d-%d", len ? "," : "", cpu, last);
+        }
+        cpu = last;
+    }
+}
+
+// Descobre os nós NUMA e suas CPUs em /sys. Sem NUMA, tudo vira o nó 0.
+void load_topology() {
+    if (placement.loaded) {
+        return;
+    }
+    placement.loaded = 1;
+    sched_getaffinity(0, sizeof(placement.allowed), &placement.allowed);
+
+    placement.num_nodes = 0;
+    for (int node = 0; node < MAX_NUMA_NODES * 4 && placement.num_nodes < MAX_NUMA_NODES; node++) {
+        char path[64], buf[MAX_BUFFER];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            continue;
+        }
+        ssize_t n = read(fd, buf, sizeof(buf) - 1);
+        close(fd);
+        if (n <= 0) {
+            continue;
+        }
+        buf[n] = '\0';
+        cpu_set_t cpus;
+        if (parse_cpulist(buf, &cpus) == 0) {
+            placement.node_ids[placement.num_nodes] = node;
+            placement.node_cpus[placement.num_nodes++] = cpus;
+        }
+    }
+    if (placement.num_nodes == 0) {
+        placement.node_ids[0] = 0;
+        placement.node_cpus[0] = placement.allowed;
+        placement.num_nodes = 1;
+    }
+}
+
+// CPUs do nó (índice) que ainda podem receber jobs em background
+int node_cpus_allowed(int idx, cpu_set_t *set) {
+    cpu_set_t usable = placement.allowed;
+    for (int cpu = 0; cpu < placement.reserve && cpu < CPU_SETSIZE; cpu++) {
+        CPU_CLR(cpu, &usable); // Reservadas para o foreground
+    }
+    CPU_AND(set, &placement.node_cpus[idx], &usable);
+    return CPU_COUNT(set);
+}
+
+int node_of_cpu(int cpu) {
+    for (int i = 0; i < placement.num_nodes; i++) {
+        if (CPU_ISSET(cpu, &placement.node_cpus[i])) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int jobs_on_node(int idx) {
+    int count = 0;
+    for (int i = 0; i < num_bg_process_groups; i++) {
+        for (int j = 0; j < bg_process_groups[i].count; j++) {
+            if (bg_process_groups[i].pids[j] != 0 && bg_process_groups[i].nodes[j] == idx) {
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+// Escolhe CPUs e nó de memória para um novo job em background. Retorna o
+// índice do nó preferido (-1 se o cpuset cruza nós) ou -2 sem placement.
+int choose_placement(const char *explicit_cpus, cpu_set_t *set) {
+    load_topology();
+
+    if (explicit_cpus != NULL) {
+        if (parse_cpulist(explicit_cpus, set) < 0) {
+            return -2;
+        }
+        int node = -1;
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, set)) {
+                int n = node_of_cpu(cpu);
+                if (node == -1) node = n; else if (n != node) return -1;
+            }
+        }
+        return node;
+    }
+
+    cpu_set_t cpus;
+    switch (placement.policy) {
+    case PLACE_RR: // Um núcleo por job, em rodízio
+        for (int tries = 0; tries < CPU_SETSIZE; tries++) {
+            int cpu = placement.next_cpu++ % CPU_SETSIZE;
+            int node = node_of_cpu(cpu);
+            if (node >= 0 && node_cpus_allowed(node, &cpus) > 0 && CPU_ISSET(cpu, &cpus)) {
+                CPU_ZERO(set);
+                CPU_SET(cpu, set);
+                return node;
+            }
+        }
+        return -2;
+
+    case PLACE_SPREAD: // Nós em rodízio, job livre dentro do nó
+        for (int tries = 0; tries < placement.num_nodes; tries++) {
+            int node = placement.next_node++ % placement.num_nodes;
+            if (node_cpus_allowed(node, set) > 0) {
+                return node;
+            }
+        }
+        return -2;
+
+    case PLACE_PACK: { // Encher um nó antes de passar para o próximo
+        int best = -1;
+        double best_load = 0;
+        for (int node = 0; node < placement.num_nodes; node++) {
+            int ncpus = node_cpus_allowed(node, &cpus);
+            if (ncpus == 0) {
+                continue;
+            }
+            double load = (double)jobs_on_node(node) / ncpus;
+            if (load < 1) {
+                best = node;
+                break;
+            }
+            if (best < 0 || load < best_load) {
+                best = node;
+                best_load = load;
+            }
+        }
+        if (best < 0) {
+            return -2;
+        }
+        node_cpus_allowed(best, set);
+        return best;
+    }
+
+    default:
+        return -2;
+    }
+}
+
+// Aplicado no filho antes do exec; os processos secundários herdam
+void apply_placement(const cpu_set_t *set, int node) {
+    if (sched_setaffinity(0, sizeof(*set), set) < 0) {
+        perror("Erro ao definir afinidade de CPU");
+    }
+    if (node >= 0) {
+        unsigned long mask[MAX_NUMA_NODES * 4 / (8 * sizeof(unsigned long)) + 1] = { 0 };
+        int id = placement.node_ids[node];
+        mask[id / (8 * sizeof(unsigned long))] |= 1UL << (id % (8 * sizeof(unsigned long)));
+        if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask, sizeof(mask) * 8) < 0 && errno != ENOSYS) {
+            perror("Erro ao definir política de memória");
+        }
+    }
+}
+
+// placement [none|rr|pack|spread] [reserve=N]
+void placement_command(char *args) {
+    char *save;
+    for (char *arg = strtok_r(args, " ", &save); arg; arg = strtok_r(NULL, " ", &save)) {
+        if (strcmp(arg, "none") == 0) placement.policy = PLACE_NONE;
+        else if (strcmp(arg, "rr") == 0) placement.policy = PLACE_RR;
+        else if (strcmp(arg, "pack") == 0) placement.policy = PLACE_PACK;
+        else if (strcmp(arg, "spread") == 0) placement.policy = PLACE_SPREAD;
+        else if (strncmp(arg, "reserve=", 8) == 0) placement.reserve = atoi(arg + 8);
+        else {
+            printf("Uso: placement [none|rr|pack|spread] [reserve=N]\n");
+            return;
+        }
+    }
+    load_topology();
+    static const char *names[] = { "none", "rr", "pack", "spread" };
+    printf("Política: %s, %d CPUs reservadas para o foreground\n", names[placement.policy], placement.reserve);
+    for (int i = 0; i < placement.num_nodes; i++) {
+        char cpus[256];
+        format_cpulist(&placement.node_cpus[i], cpus, sizeof(cpus));
+        printf("  nó %d: CPUs %s, %d jobs\n", placement.node_ids[i], cpus, jobs_on_node(i));
+    }
+}
+
+// jobs [-v]
+void jobs_command(char *args) {
+    int verbose = strstr(args, "-v") != NULL;
+    int64_t now = now_ns();
+    for (int i = 0; i < num_bg_process_groups; i++) {
+        ProcessGroup *group = &bg_process_groups[i];
+        if (group->array != 0) {
+            JobArray *array = &job_arrays[group->array - 1];
+            printf("[%d]%s%s array %ld-%ld  %ld/%ld concluídas, %ld falharam, %d rodando%s%s%s%s\n", group->id,
+                   group->label[0] ? " %" : "", group->label, array->start, array->end, array->done, array->total,
+                   array->failed, array->running, array->cancelled ? "  (cancelado)" : "",
+                   group->paused_seq ? "  (suspenso por memória)" : "", group->stopped ? "  (parado)" : "",
+                   group->gang_paused ? "  (aguardando vez)" : "");
+            if (!verbose) {
+                continue; // Os processos das tarefas só com -v
+            }
+        }
+        for (int j = 0; j < group->count; j++) {
+            if (group->pids[j] == 0) {
+                continue;
+            }
+            printf("[%d]%s%s %d  %6.1fs  %s%s%s%s", group->id, group->label[0] ? " %" : "", group->label,
+                   group->pids[j], (now - group->started_ns[j]) / 1e9, group->names[j],
+                   group->paused_seq ? "  (suspenso por memória)" : "", group->stopped ? "  (parado)" : "",
+                   group->gang_paused ? "  (aguardando vez)" : "");
+            if (verbose) {
+                if (group->nodes[j] == -2) {
+                    printf("  (sem placement)");
+                } else {
+                    printf("  (CPUs %s", group->cpus[j]);
+                    if (group->nodes[j] >= 0) {
+                        printf(", memória no nó %d", placement.node_ids[group->nodes[j]]);
+                    }
+                    printf(")");
+                }
+            }
+            printf("\n");
+        }
+        supervise_jobs_lines(group);
+    }
+    if (admission_len > 0) {
+        printf("%d comandos aguardando admissão\n", admission_len);
+    }
+}
+
+// Classe de escalonamento de um job: política do kernel, nice e prioridade
+// de IO. Os grupos em background rodam por padrão em SCHED_BATCH, com nice
+// maior e IO ocioso, para não disputar CPU e disco com o foreground.
+int ioprio_value(int io_class) {
+    return io_class << IOPRIO_CLASS_SHIFT; // Nível 0 dentro da classe
+}
+
+int sched_policy_value(const char *name) {
+    if (strcmp(name, "normal") == 0) return SCHED_OTHER;
+    if (strcmp(name, "batch") == 0) return SCHED_BATCH;
+    if (strcmp(name, "idle") == 0) return SCHED_IDLE;
+    return -1;
+}
+
+const char *sched_policy_name(int policy) {
+    return policy == SCHED_BATCH ? "batch" : policy == SCHED_IDLE ? "idle" : "normal";
+}
+
+const char *io_class_name(int io_class) {
+    return io_class == IOPRIO_CLASS_IDLE ? "idle" : io_class == IOPRIO_CLASS_BE ? "besteffort" : "none";
+}
+
+// Aplica a classe ao processo atual (chamado no filho antes do exec)
+void apply_sched_class(const SchedClass *cls) {
+    struct sched_param param = { .sched_priority = 0 };
+    if (sched_setscheduler(0, cls->policy, &param) < 0) {
+        perror("Erro ao definir política de escalonamento");
+    }
+    if (setpriority(PRIO_PROCESS, 0, cls->nice) < 0) {
+        perror("Erro ao definir nice");
+    }
+    if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, ioprio_value(cls->io_class)) < 0) {
+        perror("Erro ao definir prioridade de IO");
+    }
+}
+
+// Reclassifica um grupo já em execução (por exemplo ao movê-lo entre
+// foreground e background). Nice e IO têm chamadas por grupo; a política do
+// escalonador é por processo, então os membros são achados em /proc.
+// Reduzir o nice exige CAP_SYS_NICE ou RLIMIT_NICE suficiente.
+int reclassify_group(pid_t pgid, const SchedClass *cls) {
+    int failed = 0;
+    struct sched_param param = { .sched_priority = 0 };
+
+#if FSH_SIGNALS == FSH_SIGNALS_PROCESS
+    // Sem grupos próprios o job divide o grupo com a shell: só o processo muda
+    failed |= sched_setscheduler(pgid, cls->policy, &param) < 0;
+    failed |= setpriority(PRIO_PROCESS, pgid, cls->nice) < 0;
+    failed |= syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, pgid, ioprio_value(cls->io_class)) < 0;
+#else
+    DIR *proc = opendir("/proc");
+    if (proc != NULL) {
+        struct dirent *entry;
+        while ((entry = readdir(proc)) != NULL) {
+            pid_t pid = atoi(entry->d_name);
+            if (pid > 0 && getpgid(pid) == pgid && sched_setscheduler(pid, cls->policy, &param) < 0) {
+                failed = 1;
+            }
+        }
+        closedir(proc);
+    }
+    if (setpriority(PRIO_PGRP, pgid, cls->nice) < 0) {
+        failed = 1;
+    }
+    if (syscall(SYS_ioprio_set, IOPRIO_WHO_PGRP, pgid, ioprio_value(cls->io_class)) < 0) {
+        failed = 1;
+    }
+#endif
+    return failed ? -1 : 0;
+}
+
+// Reclassifica o job inteiro: pelo grupo comum da linha ou processo a processo
+void reclassify_job(ProcessGroup *group, const SchedClass *cls) {
+    int failed = 0;
+    if (group->pgid > 0) {
+        failed = reclassify_group(group->pgid, cls) < 0;
+    } else {
+        for (int j = 0; j < group->count; j++) {
+            if (group->pids[j] != 0 && reclassify_group(group->pids[j], cls) < 0) {
+                failed = 1;
+            }
+        }
+    }
+    if (failed) {
+        printf("Aviso: não foi possível reclassificar o grupo [%d] por completo\n", group->id);
+    }
+}
+
+// sched [bg|fg] [policy=normal|batch|idle] [nice=N] [io=idle|besteffort|none]
+void sched_command(char *args) {
+    SchedClass *cls = &bg_sched_class;
+    int changed = 0;
+    char *save;
+    for (char *arg = strtok_r(args, " ", &save); arg; arg = strtok_r(NULL, " ", &save)) {
+        if (strcmp(arg, "bg") == 0) {
+            cls = &bg_sched_class;
+        } else if (strcmp(arg, "fg") == 0) {
+            cls = &fg_sched_class;
+        } else if (strncmp(arg, "policy=", 7) == 0 && sched_policy_value(arg + 7) >= 0) {
+            cls->policy = sched_policy_value(arg + 7);
+            changed = 1;
+        } else if (strncmp(arg, "nice=", 5) == 0) {
+            cls->nice = atoi(arg + 5);
+            changed = 1;
+        } else if (strcmp(arg, "io=idle") == 0 || strcmp(arg, "io=besteffort") == 0 || strcmp(arg, "io=none") == 0) {
+            cls->io_class = arg[3] == 'i' ? IOPRIO_CLASS_IDLE : arg[3] == 'b' ? IOPRIO_CLASS_BE : IOPRIO_CLASS_NONE;
+            changed = 1;
+        } else {
+            printf("Uso: sched [bg|fg] [policy=normal|batch|idle] [nice=N] [io=idle|besteffort|none]\n");
+            return;
+        }
+    }
+
+    // Aplicar a nova classe aos grupos já em execução
+    if (changed && cls == &bg_sched_class) {
+        for (int i = 0; i < num_bg_process_groups; i++) {
+            reclassify_job(&bg_process_groups[i], cls);
+        }
+    }
+
+    printf("background: policy=%s nice=%d io=%s\n", sched_policy_name(bg_sched_class.policy),
+           bg_sched_class.nice, io_class_name(bg_sched_class.io_class));
+    printf("foreground: policy=%s nice=%d io=%s\n", sched_policy_name(fg_sched_class.policy),
+           fg_sched_class.nice, io_class_name(fg_sched_class.io_class));
+}
+
+// Roda de timers hierárquica para prazos de jobs. São WHEEL_LEVELS níveis de
+// WHEEL_SLOTS posições; o nível l guarda timers que vencem dentro de
+// WHEEL_SLOTS^(l+1) ticks e é redistribuído para o nível de baixo quando a
+// posição atual dá a volta. Inserir, cancelar e disparar custam O(1), e um
+// único timerfd, só armado enquanto há timers, acorda o loop principal.
+void timer_unlink(int id) {
+    TimerNode *t = &timer_pool[id];
+    if (t->prev >= 0) {
+        timer_pool[t->prev].next = t->next;
+    } else {
+        wheel.slots[t->level][t->slot] = t->next;
+    }
+    if (t->next >= 0) {
+        timer_pool[t->next].prev = t->prev;
+    }
+}
+
+void timer_place(int id) {
+    TimerNode *t = &timer_pool[id];
+    int64_t delta = t->expire - wheel.now;
+    int level = 0;
+    while (level < WHEEL_LEVELS - 1 && delta >= (1LL << (WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    int64_t expire = t->expire;
+    if (delta >= (1LL << (WHEEL_BITS * WHEEL_LEVELS))) {
+        expire = wheel.now + (1LL << (WHEEL_BITS * WHEEL_LEVELS)) - 1; // Volta a ser avaliado no fim da roda
+    }
+    t->level = level;
+    t->slot = (expire >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1);
+    t->prev = -1;
+    t->next = wheel.slots[level][t->slot];
+    if (t->next >= 0) {
+        timer_pool[t->next].prev = id;
+    }
+    wheel.slots[level][t->slot] = id;
+}
+
+int64_t wheel_current_tick() {
+    return (mono_ns() - wheel.base_ns) / TIMER_TICK_NS;
+}
+
+// Liga o timerfd periódico quando o primeiro timer entra e desliga com o último
+void wheel_arm(int on) {
+    struct itimerspec its = { 0 };
+    if (on) {
+        its.it_value.tv_nsec = TIMER_TICK_NS;
+        its.it_interval.tv_nsec = TIMER_TICK_NS;
+    }
+    timerfd_settime(wheel.fd, 0, &its, NULL);
+}
+
+void wheel_init() {
+    wheel.fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (wheel.fd < 0) {
+        perror("Erro ao criar timerfd");
+    }
+    wheel.base_ns = mono_ns();
+    for (int l = 0; l < WHEEL_LEVELS; l++) {
+        for (int s = 0; s < WHEEL_SLOTS; s++) {
+            wheel.slots[l][s] = -1;
+        }
+    }
+    for (int i = 0; i < MAX_TIMERS; i++) {
+        timer_pool[i].next = i + 1 < MAX_TIMERS ? i + 1 : -1;
+    }
+    wheel.free_list = 0;
+}
+
+// Agenda um timer para daqui a 'ms' milissegundos; retorna seu id ou -1
+int timer_add(int64_t ms, int group_id, pid_t pid, int stage) {
+    if (wheel.base_ns == 0) {
+        wheel_init(); // No modo -c a roda só é criada no primeiro timer
+    }
+    if (wheel.fd < 0 || wheel.free_list < 0) {
+        return -1;
+    }
+    int id = wheel.free_list;
+    TimerNode *t = &timer_pool[id];
+    wheel.free_list = t->next;
+    // O vencimento conta do tick real; o cursor fica onde está, e os ticks
+    // que ele ainda não processou (com as cascatas) ficam para o wheel_run
+    int64_t now = wheel_current_tick();
+    int64_t ticks = (ms * 1000000LL + TIMER_TICK_NS - 1) / TIMER_TICK_NS;
+    t->expire = (now > wheel.now ? now : wheel.now) + (ticks > 0 ? ticks : 1);
+    t->group_id = group_id;
+    t->pid = pid;
+    t->stage = stage;
+    t->in_use = 1;
+    timer_place(id);
+    if (wheel.count++ == 0) {
+        wheel_arm(1);
+    }
+    return id;
+}
+
+void timer_cancel(int id) {
+    if (id < 0 || !timer_pool[id].in_use) {
+        return;
+    }
+    timer_unlink(id);
+    timer_pool[id].in_use = 0;
+    timer_pool[id].next = wheel.free_list;
+    wheel.free_list = id;
+    if (--wheel.count == 0) {
+        wheel_arm(0);
+    }
+}
+
+// Envia o sinal a um processo e a todos os seus descendentes, achados pelo
+// PPID no /proc. É o que alcança um comando da linha sem atingir os outros:
+// o grupo de processos é da linha inteira, e o comando de fato costuma rodar
+// em um filho do /bin/sh -c. Retorna quantos processos receberam o sinal.
+int signal_process_tree(pid_t root, int sig) {
+    pid_t tree[MAX_TREE_PIDS] = { root };
+    int count = 1;
+    pid_t (*procs)[2] = NULL; // PID e PPID de cada processo
+    int num_procs = 0, cap = 0;
+    DIR *dir = opendir("/proc");
+    struct dirent *entry;
+    while (dir != NULL && (entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] < '0' || entry->d_name[0] > '9') {
+            continue;
+        }
+        char path[300], buf[512];
+        snprintf(path, sizeof(path), "/proc/%s/stat", entry->d_name);
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        ssize_t n = read(fd, buf, sizeof(buf) - 1);
+        close(fd);
+        buf[n > 0 ? n : 0] = '\0';
+        char *p = strrchr(buf, ')'); // O nome do comando pode ter espaços
+        int ppid;
+        if (p == NULL || sscanf(p + 2, "%*c %d", &ppid) != 1) {
+            continue;
+        }
+        if (num_procs == cap) {
+            cap = cap ? cap * 2 : 256;
+            pid_t (*grown)[2] = realloc(procs, cap * sizeof(*procs));
+            if (grown == NULL) {
+                break;
+            }
+            procs = grown;
+        }
+        procs[num_procs][0] = atoi(entry->d_name);
+        procs[num_procs][1] = ppid;
+        num_procs++;
+    }
+    if (dir != NULL) {
+        closedir(dir);
+    }
+    // Cada processo da árvore traz os seus filhos; tree cresce em largura
+    for (int k = 0; k < count; k++) {
+        for (int i = 0; i < num_procs && count < MAX_TREE_PIDS; i++) {
+            if (procs[i][1] == tree[k]) {
+                tree[count++] = procs[i][0];
+            }
+        }
+    }
+    free(procs);
+    int signalled = 0;
+    for (int k = 0; k < count; k++) {
+        signalled += kill(tree[k], sig) == 0;
+    }
+    return signalled;
+}
+
+// Prazo vencido: SIGTERM no grupo (ou job) e, após a carência, SIGKILL
+void timer_fire(TimerNode *t) {
+    if (t->stage == 2 || t->stage == 3) { // Reinício ou verificação de saúde; pid é a entrada do supervisor
+        supervise_timer(t);
+        return;
+    }
+    if (t->stage == 4) {
+        gang_timer();
+        return;
+    }
+    int sig = t->stage == 0 ? SIGTERM : SIGKILL;
+
+    if (t->group_id < 0) { // Job em foreground
+        if (fg_process_pid != t->pid) {
+            return;
+        }
+        printf("\nJob em foreground (PID=%d) excedeu o prazo, enviando %s\n", t->pid, sig == SIGTERM ? "SIGTERM" : "SIGKILL");
+        signal_job(t->pid, sig);
+        if (sig == SIGTERM) {
+            fg_timer = timer_add(job_timeouts.grace_ms, t->group_id, t->pid, 1);
+        }
+        return;
+    }
+
+    ProcessGroup *group = find_bg_group(t->group_id);
+    if (group == NULL) {
+        return;
+    }
+    if (t->pid == 0) { // Prazo do grupo inteiro
+        printf("\nGrupo [%d] excedeu o prazo, enviando %s\n", group->id, sig == SIGTERM ? "SIGTERM" : "SIGKILL");
+        if (group->array != 0) {
+            job_arrays[group->array - 1].cancelled = 1; // O prazo vale para o array inteiro
+        }
+        supervise_cancel_group(group);
+        propagate_signal_to_group(group, sig);
+        if (sig == SIGTERM) {
+            group->deadline_timer = timer_add(job_timeouts.grace_ms, t->group_id, 0, 1);
+        }
+        return;
+    }
+    for (int j = 0; j < group->count; j++) {
+        if (group->pids[j] == t->pid) {
+            printf("\nJob [%d] %d excedeu o prazo, enviando %s\n", group->id, t->pid, sig == SIGTERM ? "SIGTERM" : "SIGKILL");
+            int n = signal_process_tree(t->pid, sig); // Só este comando: o grupo é da linha inteira
+            atomic_fetch_add_explicit(&metrics->signals_forwarded, n, memory_order_relaxed);
+            group->timers[j] = sig == SIGTERM ? timer_add(job_timeouts.grace_ms, t->group_id, t->pid, 1) : -1;
+            return;
+        }
+    }
+}
+
+// Avança a roda até o tick atual, redistribuindo e disparando timers
+void wheel_run() {
+    uint64_t expirations;
+    while (read(wheel.fd, &expirations, sizeof(expirations)) > 0);
+
+    int64_t target = wheel_current_tick();
+    while (wheel.now < target && wheel.count > 0) {
+        wheel.now++;
+
+        // Redistribuir do nível mais alto que deu a volta para baixo
+        int top = 0;
+        while (top + 1 < WHEEL_LEVELS && (wheel.now & ((1LL << (WHEEL_BITS * (top + 1))) - 1)) == 0) {
+            top++;
+        }
+        for (int level = top; level >= 1; level--) {
+            int slot = (wheel.now >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1);
+            int id = wheel.slots[level][slot];
+            wheel.slots[level][slot] = -1;
+            while (id >= 0) {
+                int next = timer_pool[id].next;
+                timer_place(id);
+                id = next;
+            }
+        }
+
+        int slot = wheel.now & (WHEEL_SLOTS - 1);
+        int id = wheel.slots[0][slot];
+        wheel.slots[0][slot] = -1;
+        while (id >= 0) {
+            TimerNode fired = timer_pool[id];
+            int next = fired.next;
+            if (fired.expire <= wheel.now) {
+                timer_pool[id].in_use = 0;
+                timer_pool[id].next = wheel.free_list;
+                wheel.free_list = id;
+                if (--wheel.count == 0) {
+                    wheel_arm(0);
+                }
+                timer_fire(&fired);
+            } else {
+                timer_place(id); // Prazo além do alcance da roda
+            }
+            id = next;
+        }
+    }
+    wheel.now = target;
+    fflush(stdout);
+}
+
+// timeout [default=N] [grace=N]   (segundos; 0 desliga o prazo padrão)
+void timeout_command(char *args) {
+    char *save;
+    for (char *arg = strtok_r(args, " ", &save); arg; arg = strtok_r(NULL, " ", &save)) {
+        if (strncmp(arg, "default=", 8) == 0) {
+            job_timeouts.default_ms = (int64_t)(atof(arg + 8) * 1000);
+        } else if (strncmp(arg, "grace=", 6) == 0) {
+            job_timeouts.grace_ms = (int64_t)(atof(arg + 6) * 1000);
+        } else {
+            printf("Uso: timeout [default=N] [grace=N]\n");
+            return;
+        }
+    }
+    printf("Prazo padrão dos grupos em background: %.1fs, carência até SIGKILL: %.1fs, %d timers ativos\n",
+           job_timeouts.default_ms / 1000.0, job_timeouts.grace_ms / 1000.0, wheel.count);
+}
+
+// Saída dos jobs em background com prefixo. No modo "tagged" cada processo
+// escreve em um pipe; o loop principal lê os pipes, remonta linhas inteiras e
+// as escreve no terminal com "[job:pid] " na frente, em um único writev por
+// rodada. Enquanto o writev está bloqueado os pipes não são lidos, então um
+// terminal lento acaba segurando os próprios jobs (backpressure).
+int output_pipe_open(int out[2]) {
+    if (!output_tagged || num_output_streams >= MAX_OUTPUT_STREAMS) {
+        out[0] = out[1] = -1;
+        return 0;
+    }
+    if (pipe2(out, O_CLOEXEC) < 0) {
+        perror("Erro ao criar o pipe de saída");
+        out[0] = out[1] = -1;
+        return -1;
+    }
+    return 0;
+}
+
+// No filho: stdout e stderr passam a ser o pipe (dup2 limpa o O_CLOEXEC)
+void output_pipe_child(int out[2]) {
+    if (out[1] >= 0) {
+        dup2(out[1], STDOUT_FILENO);
+        dup2(out[1], STDERR_FILENO);
+        setvbuf(stdout, NULL, _IOLBF, 0); // O printf antes do exec não pode ficar no buffer
+    }
+}
+
+void output_pipe_parent(int out[2], int group_id, pid_t pid) {
+    if (out[1] < 0) {
+        return;
+    }
+    close(out[1]);
+    if (pid < 0) {
+        close(out[0]);
+        return;
+    }
+    fcntl(out[0], F_SETFL, O_NONBLOCK);
+    OutputStream *s = &output_streams[num_output_streams++];
+    s->fd = out[0];
+    s->len = 0;
+    s->eof = 0;
+    s->prefix_len = snprintf(s->prefix, sizeof(s->prefix), "[%d:%d] ", group_id, pid);
+}
+
+// Preenche os pollfds dos pipes; sem espaço no buffer o pipe não é lido
+int output_poll_fds(struct pollfd *pfds) {
+    for (int i = 0; i < num_output_streams; i++) {
+        pfds[i].fd = output_streams[i].fd;
+        pfds[i].events = output_streams[i].len < OUTPUT_BUF_LEN ? POLLIN : 0;
+        pfds[i].revents = 0;
+    }
+    return num_output_streams;
+}
+
+void writev_all(struct iovec *iov, int count) {
+    while (count > 0) {
+        ssize_t n = writev(STDOUT_FILENO, iov, count);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Erro ao escrever a saída dos jobs");
+            return;
+        }
+        while (count > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+}
+
+// Lê os pipes prontos e escreve as linhas completas. Uma linha maior que o
+// buffer, ou o resto sem '\n' de um pipe fechado, sai como linha própria.
+// Retorna 1 se algo foi escrito.
+int output_pump(struct pollfd *pfds, int at_prompt) {
+    static char newline = '\n';
+    struct iovec iov[OUTPUT_IOV_MAX];
+    size_t consumed[MAX_OUTPUT_STREAMS];
+    int count = 0;
+    int wrote = 0;
+
+    for (int i = 0; i < num_output_streams; i++) {
+        OutputStream *s = &output_streams[i];
+        consumed[i] = 0;
+        if (pfds != NULL && !(pfds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+            continue;
+        }
+        ssize_t n = read(s->fd, s->buf + s->len, OUTPUT_BUF_LEN - s->len);
+        if (n > 0) {
+            s->len += n;
+        } else if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+            s->eof = 1;
+        }
+    }
+
+    fflush(stdout); // O que a shell já imprimiu vem antes
+    for (int i = 0; i < num_output_streams; i++) {
+        OutputStream *s = &output_streams[i];
+        while (consumed[i] < s->len) {
+            char *line = s->buf + consumed[i];
+            size_t avail = s->len - consumed[i];
+            char *nl = memchr(line, '\n', avail);
+            size_t n = nl ? (size_t)(nl - line + 1) : avail;
+            if (nl == NULL && !s->eof && s->len < OUTPUT_BUF_LEN) {
+                break; // Esperar o resto da linha
+            }
+            if (count + 4 > OUTPUT_IOV_MAX) {
+                writev_all(iov, count);
+                count = 0;
+            }
+            if (!wrote && at_prompt) {
+                iov[count++] = (struct iovec){ &newline, 1 };
+            }
+            wrote = 1;
+            iov[count++] = (struct iovec){ s->prefix, s->prefix_len };
+            iov[count++] = (struct iovec){ line, n };
+            if (nl == NULL) {
+                iov[count++] = (struct iovec){ &newline, 1 };
+            }
+            consumed[i] += n;
+        }
+    }
+    if (count > 0) {
+        writev_all(iov, count);
+    }
+
+    // Só depois do writev os buffers podem ser compactados
+    int k = 0;
+    for (int i = 0; i < num_output_streams; i++) {
+        OutputStream *s = &output_streams[i];
+        memmove(s->buf, s->buf + consumed[i], s->len - consumed[i]);
+        s->len -= consumed[i];
+        if (s->eof && s->len == 0) {
+            close(s->fd);
+            continue;
+        }
+        if (k != i) {
+            output_streams[k] = *s;
+        }
+        k++;
+    }
+    num_output_streams = k;
+    return wrote;
+}
+
+void output_command(char *args) {
+    while (*args == ' ') args++;
+    if (strcmp(args, "tagged") == 0) {
+        output_tagged = 1;
+    } else if (strcmp(args, "direct") == 0) {
+        output_tagged = 0;
+    } else if (*args != '\0') {
+        printf("Uso: output [tagged|direct]\n");
+        return;
+    }
+    printf("Saída dos jobs em background: %s, %d pipes abertos\n",
+           output_tagged ? "tagged" : "direct", num_output_streams);
+}
+
+// Registra no grupo um processo recém-criado, com o posicionamento dele
+int track_spawned(ProcessGroup *group, pid_t pid, const char *command, const cpu_set_t *cpus, int node) {
+    int slot = track_process(group, pid, command);
+    if (slot >= 0) {
+        if (node != -2) {
+            format_cpulist(cpus, group->cpus[slot], PLACEMENT_DESC_LEN);
+            group->nodes[slot] = node;
+        }
+        metrics_spawned(1);
+    } else {
+        metrics_spawned(0);
+        printf("Número máximo de processos em background atingido\n");
+    }
+    return slot;
+}
+
+// Cria um processo do job em background. O primeiro processo da linha cria
+// o grupo de processos e os seguintes (inclusive os secundários irmãos,
+// FSH_SECONDARY_SIBLING) entram nele. Com FSH_SECONDARY_CHILD, o PID do Px'
+// registrado no grupo vai para *adopted (0 se não houver).
+pid_t spawn_background_process(char *command, char **envp, ProcessGroup *group, int secondary,
+                               const cpu_set_t *cpus, int node, pid_t *adopted) {
+    pid_t pgid = group->pgid;
+    int probe[2], out[2];
+    uint64_t counters[PROF_COUNTERS];
+    exec_probe_open(probe);
+    output_pipe_open(out);
+#if FSH_SECONDARY == FSH_SECONDARY_CHILD
+    int with_secondary = find_dag_group(group->id) == NULL; // Um job do DAG roda uma vez só
+#endif
+    profile_before_fork(counters);
+    int64_t fork_ns = mono_ns();
+    pid_t pid = fork();
+
+    if (pid < 0) {
+        perror("Erro no fork");
+        metrics_spawn_failed();
+        exec_probe_close(probe);
+        output_pipe_parent(out, group->id, -1);
+        profile_after_fork(pid, counters);
+        return -1;
+    }
+
+    if (pid == 0) {  // Processo filho (background)
+        profile_child_wait();
+        exec_probe_child(probe);
+        output_pipe_child(out);
+        join_process_group(pgid); // Definir novo grupo de processos
+        signal(SIGINT, SIG_IGN); // Ignorar SIGINT
+        if (node != -2) {
+            apply_placement(cpus, node);
+        }
+        apply_sched_class(&bg_sched_class);
+#if FSH_SECONDARY == FSH_SECONDARY_CHILD
+        // Px' nasce de um intermediário que sai logo em seguida: órfão, ele é
+        // adotado pela shell (subreaper) e reapado por ela. Filho direto de
+        // Px, ficaria zumbi enquanto o comando de Px rodasse, já que esse
+        // comando não sabe que tem um filho para esperar.
+        if (with_secondary) {
+            pid_t child_pid = fork();
+
+            if (child_pid < 0) {
+                perror("Erro no fork do processo secundário");
+                metrics_spawn_failed();
+                exit(1);
+            }
+
+            if (child_pid == 0) {
+                pid_t secondary_pid = fork();
+                if (secondary_pid == 0) {  // Processo secundário (Px')
+                    launcher_exec(command, envp);
+                    perror("Erro ao executar comando no processo secundário");
+                    exit(1);
+                }
+                if (secondary_pid < 0) {
+                    perror("Erro no fork do processo secundário");
+                } else if (probe[1] >= 0) {
+                    write(probe[1], &secondary_pid, sizeof(secondary_pid)); // A shell avisa o início de Px'
+                }
+                _exit(secondary_pid < 0);
+            }
+            waitpid(child_pid, NULL, 0);
+        }
+#endif
+        launcher_exec(command, envp);
+        perror("Erro ao executar comando em background");
+        exit(1);
+    }
+
+    profile_after_fork(pid, counters);
+#if FSH_SIGNALS == FSH_SIGNALS_GROUP
+    if (setpgid(pid, pgid ? pgid : pid) < 0 && pgid != 0) { // Também no pai, para não depender da ordem
+        setpgid(pid, pid);
+    }
+    if (group->pgid == 0) {
+        group->pgid = pid;
+    }
+#endif
+    output_pipe_parent(out, group->id, pid);
+    pid_t secondary_pid = exec_probe_wait(probe, fork_ns);
+    profile_exec_done(pid);
+    notify_started(group->id, pid, command, secondary);
+    track_spawned(group, pid, command, cpus, node);
+#if FSH_SECONDARY == FSH_SECONDARY_CHILD
+    // Quando o probe fecha, o intermediário já saiu e Px' foi adotado pela
+    // shell (subreaper). Com vaga própria no grupo, ele é reapado, registrado
+    // no log, avisado e sinalizado como os outros processos do job.
+    int subreaper = 0;
+    if (secondary_pid > 0) {
+        notify_started(group->id, secondary_pid, command, 1);
+        if (prctl(PR_GET_CHILD_SUBREAPER, &subreaper) < 0 || !subreaper ||
+            track_spawned(group, secondary_pid, command, cpus, node) < 0) {
+            secondary_pid = 0; // Ficou com o init (fsh -n -c) ou sem vaga
+        }
+    }
+    if (adopted != NULL) {
+        *adopted = secondary_pid;
+    }
+#else
+    (void)secondary_pid;
+    if (adopted != NULL) {
+        *adopted = 0;
+    }
+#endif
+    return pid;
+}
+
+// Arena de alocação reaproveitada a cada criação de processo. O envp de um
+// job é montado aqui pelo pai antes do fork; o filho recebe sua cópia pelo
+// copy-on-write do fork e só precisa passá-la ao exec, sem malloc nem setenv.
+void *arena_alloc(Arena *arena, size_t size) {
+    size = (size + 7) & ~(size_t)7;
+    if (arena->used + size > arena->size) {
+        return NULL;
+    }
+    void *ptr = arena->base + arena->used;
+    arena->used += size;
+    return ptr;
+}
+
+int arena_reserve(Arena *arena, size_t size) {
+    arena->used = 0;
+    if (size <= arena->size) {
+        return 0;
+    }
+    char *base = realloc(arena->base, size);
+    if (base == NULL) {
+        return -1;
+    }
+    arena->base = base;
+    arena->size = size;
+    return 0;
+}
+
+// "NOME=" com NOME válido para uma variável de ambiente
+int is_env_assignment(const char *token) {
+    if (!(*token == '_' || (*token >= 'A' && *token <= 'Z') || (*token >= 'a' && *token <= 'z'))) {
+        return 0;
+    }
+    const char *p = token + 1;
+    while (*p == '_' || (*p >= 'A' && *p <= 'Z') || (*p >= 'a' && *p <= 'z') || (*p >= '0' && *p <= '9')) {
+        p++;
+    }
+    return *p == '=';
+}
+
+// Monta o envp do job: os ponteiros de environ são reaproveitados (sem cópia
+// das strings) e só as variáveis sobrescritas ou novas apontam para a arena.
+// Retorna NULL quando o job não altera o ambiente.
+char **build_job_env(JobOptions *opts) {
+    if (opts->num_env == 0) {
+        return NULL;
+    }
+    size_t num_environ = 0;
+    while (environ[num_environ] != NULL) num_environ++;
+
+    if (arena_reserve(&spawn_arena, (num_environ + opts->num_env + 1) * sizeof(char *) + 8) < 0) {
+        perror("Erro ao alocar o ambiente do job");
+        return NULL;
+    }
+    char **envp = arena_alloc(&spawn_arena, (num_environ + opts->num_env + 1) * sizeof(char *));
+    size_t n = 0;
+    for (size_t i = 0; i < num_environ; i++) {
+        int overridden = 0;
+        for (int k = 0; k < opts->num_env && !overridden; k++) {
+            size_t len = strchr(opts->env[k], '=') - opts->env[k] + 1; // Inclui o '='
+            overridden = strncmp(environ[i], opts->env[k], len) == 0;
+        }
+        if (!overridden) {
+            envp[n++] = environ[i];
+        }
+    }
+    for (int k = 0; k < opts->num_env; k++) {
+        envp[n++] = opts->env[k]; // Strings ficam no próprio buffer do comando
+    }
+    envp[n] = NULL;
+    return envp;
+}
+
+// Remove as aspas de um valor no próprio buffer, que termina no primeiro
+// espaço fora delas. Retorna o que vem depois do valor; o terminador fica
+// por conta de quem chama, em *value_end.
+char *unquote_value(char *value, char **value_end) {
+    char *src = value, *dst = value;
+    char quote = 0;
+    while (*src != '\0' && (quote || *src != ' ')) {
+        if (quote && *src == quote) {
+            quote = 0;
+        } else if (!quote && (*src == '\'' || *src == '"')) {
+            quote = *src;
+        } else {
+            *dst++ = *src;
+        }
+        src++;
+    }
+    while (*src == ' ') src++;
+    *value_end = dst;
+    return src;
+}
+
+// Remove do início do comando os prefixos "cpuset:LISTA", "timeout:N", "name:ROTULO",
+// "restart:never|on-failure|always", "health:CMD", "prio:N", "deadline:S",
+// "share:NOME" e atribuições "NOME=valor"
+// (o valor de health: e das atribuições pode estar entre aspas). Uma
+// atribuição só é tratada como prefixo se houver um comando depois dela.
+char *parse_job_options(char *command, JobOptions *opts) {
+    opts->cpus = NULL;
+    opts->timeout_ms = 0;
+    opts->num_env = 0;
+    opts->name = NULL;
+    opts->priority = 0;
+    opts->deadline_ms = 0;
+    opts->share = NULL;
+    opts->restart = -1;
+    opts->health = NULL;
+    while (1) {
+        if (strncmp(command, "cpuset:", 7) == 0 || strncmp(command, "timeout:", 8) == 0 ||
+            strncmp(command, "name:", 5) == 0 || strncmp(command, "restart:", 8) == 0 ||
+            strncmp(command, "prio:", 5) == 0 || strncmp(command, "deadline:", 9) == 0 ||
+            strncmp(command, "share:", 6) == 0) {
+            char *value = strchr(command, ':') + 1;
+            char *rest = value + strcspn(value, " ");
+            if (*rest != '\0') {
+                *rest++ = '\0';
+            }
+            if (command[0] == 'c') {
+                opts->cpus = value;
+            } else if (command[0] == 'p') {
+                opts->priority = atoi(value);
+            } else if (command[0] == 'd') {
+                opts->deadline_ms = (int64_t)(atof(value) * 1000);
+            } else if (command[0] == 's') {
+                opts->share = value;
+            } else if (command[0] == 'n') {
+                opts->name = value;
+            } else if (command[0] == 'r') {
+                opts->restart = strcmp(value, "always") == 0       ? RESTART_ALWAYS
+                                : strcmp(value, "on-failure") == 0 ? RESTART_ON_FAILURE
+                                                                   : RESTART_NEVER;
+            } else {
+                opts->timeout_ms = (int64_t)(atof(value) * 1000);
+            }
+            command = rest;
+        } else if (strncmp(command, "health:", 7) == 0) {
+            char *value_end;
+            opts->health = command + 7;
+            command = unquote_value(opts->health, &value_end);
+            *value_end = '\0';
+        } else if (is_env_assignment(command) && opts->num_env < MAX_ENV_OVERRIDES) {
+            // Remover as aspas do valor no próprio buffer
+            char *value_end;
+            char *src = unquote_value(strchr(command, '=') + 1, &value_end);
+            if (*src == '\0') {
+                break; // Sem comando depois: deixar a atribuição para o launcher
+            }
+            *value_end = '\0';
+            // Como no sh, a última atribuição a um nome vale: ela ocupa a vaga da anterior
+            size_t len = strchr(command, '=') - command + 1; // Inclui o '='
+            int k = 0;
+            while (k < opts->num_env && strncmp(opts->env[k], command, len) != 0) k++;
+            opts->env[k] = command;
+            opts->num_env += k == opts->num_env;
+            command = src;
+        } else {
+            break;
+        }
+        while (*command == ' ') command++;
+    }
+    return command;
+}
+
+void start_group_deadline(ProcessGroup *group) {
+    if (job_timeouts.default_ms > 0) {
+        group->deadline_timer = timer_add(job_timeouts.default_ms, group->id, 0, 0);
+    }
+}
+
+pid_t launch_background(char *command, ProcessGroup *group) {
+    char original[MAX_BUFFER]; // O supervisor relança o comando com os prefixos
+    if (strstr(command, "restart:") != NULL) {
+        snprintf(original, sizeof(original), "%s", command);
+    }
+    JobOptions opts;
+    command = parse_job_options(command, &opts);
+    char **envp = build_job_env(&opts);
+    cpu_set_t cpus;
+    int node = choose_placement(opts.cpus, &cpus);
+
+    if (opts.name != NULL && group->label[0] == '\0') {
+        snprintf(group->label, JOB_NAME_LEN, "%s", opts.name);
+    }
+    pid_t secondary_pid;
+    pid_t pid = spawn_background_process(command, envp, group, 0, &cpus, node, &secondary_pid);
+    group->active_ns = mono_ns();
+    int slot = pid > 0 ? group_slot(group, pid) : -1;
+    if (slot >= 0 && opts.timeout_ms > 0) {
+        group->timers[slot] = timer_add(opts.timeout_ms, group->id, pid, 0);
+        int secondary_slot = secondary_pid > 0 ? group_slot(group, secondary_pid) : -1;
+        if (secondary_slot >= 0) { // Px' roda o mesmo comando e tem o mesmo prazo
+            group->timers[secondary_slot] = timer_add(opts.timeout_ms, group->id, secondary_pid, 0);
+        }
+    }
+    if (opts.restart >= 0 && group->array == 0) {
+        supervise_started(original, group, slot >= 0 ? pid : -1, &opts);
+    }
+#if FSH_SECONDARY == FSH_SECONDARY_SIBLING
+    if (pid > 0 && find_dag_group(group->id) == NULL) { // Um job do DAG roda uma vez só
+        spawn_background_process(command, envp, group, 1, &cpus, node, NULL);
+    }
+#endif
+    if (pid > 0 && group->gang_paused) {
+        propagate_signal_to_group(group, SIGSTOP); // O grupo está fora do rodízio
+    }
+    return pid;
+}
+
+// Controle de admissão dos processos em background. Antes de cada fork a
+// shell consulta a pressão do sistema (/proc/pressure e loadavg) e um token
+// bucket de taxa de criação; se algum limite for ultrapassado o comando vai
+// para a fila e é lançado pelo loop principal quando a pressão baixar.
+// Desligado por padrão: segurar jobs do usuário só com "admission on".
+int read_pressure(const char *path, double *avg10) {
+    char buf[256];
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) {
+        return -1;
+    }
+    buf[n] = '\0';
+    return sscanf(buf, "some avg10=%lf", avg10) == 1 ? 0 : -1;
+}
+
+// As médias do kernel são de 10s, então basta relê-las a cada 250ms
+void refresh_pressure() {
+    int64_t now = mono_ns();
+    if (now - admission.sampled_ns < ADMISSION_SAMPLE_NS) {
+        return;
+    }
+    admission.sampled_ns = now;
+    if (read_pressure("/proc/pressure/cpu", &admission.cpu) < 0) admission.cpu = 0;
+    if (read_pressure("/proc/pressure/memory", &admission.memory) < 0) admission.memory = 0;
+    if (read_pressure("/proc/pressure/io", &admission.io) < 0) admission.io = 0;
+    double load[1];
+    admission.load = getloadavg(load, 1) == 1 ? load[0] : 0;
+}
+
+void refill_tokens() {
+    int64_t now = mono_ns();
+    if (admission.refilled_ns != 0) {
+        admission.tokens += admission.rate * (now - admission.refilled_ns) / 1e9;
+        if (admission.tokens > admission.burst) {
+            admission.tokens = admission.burst;
+        }
+    }
+    admission.refilled_ns = now;
+}
+
+// Retorna o motivo pelo qual o lançamento deve esperar, ou NULL se pode seguir
+const char *admission_blocker() {
+    if (!admission.enabled) {
+        return NULL;
+    }
+    refresh_pressure();
+    if (admission.cpu > admission.max_cpu) return "pressão de CPU";
+    if (admission.memory > admission.max_memory) return "pressão de memória";
+    if (admission.io > admission.max_io) return "pressão de IO";
+    if (admission.max_load > 0 && admission.load > admission.max_load) return "loadavg";
+    refill_tokens();
+    if (admission.tokens < 1) return "taxa de criação";
+    return NULL;
+}
+
+void consume_token() {
+    if (admission.enabled) {
+        admission.tokens -= 1;
+    }
+}
+
+// Quantos comandos de cada grupo estão na fila, para group_is_pending não
+// percorrer o heap. Endereçamento aberto com sondagem linear; a remoção
+// desloca os seguintes para trás, sem lápides.
+int queued_slot(int id) {
+    int i = (int)((unsigned int)id * 2654435761U) & (queued_ids_cap - 1);
+    while (queued_ids[i] != 0 && queued_ids[i] != id) {
+        i = (i + 1) & (queued_ids_cap - 1);
+    }
+    return i;
+}
+
+int queued_count(int id) {
+    return queued_ids_cap > 0 ? queued_counts[queued_slot(id)] : 0;
+}
+
+int queued_count_add(int id, int delta) {
+    if (delta > 0 && (admission_len + 1) * 2 > queued_ids_cap) { // Cada comando usa no máximo uma entrada
+        int old_cap = queued_ids_cap, *old_ids = queued_ids, *old_counts = queued_counts;
+        int cap = old_cap > 0 ? old_cap * 2 : 1024;
+        int *ids = calloc(cap, sizeof(int)), *counts = calloc(cap, sizeof(int));
+        if (ids == NULL || counts == NULL) {
+            free(ids);
+            free(counts);
+            return -1;
+        }
+        queued_ids = ids;
+        queued_counts = counts;
+        queued_ids_cap = cap;
+        for (int i = 0; i < old_cap; i++) {
+            if (old_ids[i] != 0) {
+                int j = queued_slot(old_ids[i]);
+                queued_ids[j] = old_ids[i];
+                queued_counts[j] = old_counts[i];
+            }
+        }
+        free(old_ids);
+        free(old_counts);
+    }
+    int i = queued_slot(id);
+    queued_ids[i] = id;
+    queued_counts[i] += delta;
+    if (queued_counts[i] > 0) {
+        return 0;
+    }
+    // Entrada zerada: puxar para trás as que sondaram por cima dela
+    queued_ids[i] = 0;
+    queued_counts[i] = 0;
+    for (int j = (i + 1) & (queued_ids_cap - 1); queued_ids[j] != 0; j = (j + 1) & (queued_ids_cap - 1)) {
+        int home = (int)((unsigned int)queued_ids[j] * 2654435761U) & (queued_ids_cap - 1);
+        if (((j - home) & (queued_ids_cap - 1)) >= ((j - i) & (queued_ids_cap - 1))) {
+            queued_ids[i] = queued_ids[j];
+            queued_counts[i] = queued_counts[j];
+            queued_ids[j] = 0;
+            queued_counts[j] = 0;
+            i = j;
+        }
+    }
+    return 0;
+}
+
+int find_share(const char *name, int create) {
+    for (int i = 0; i < num_shares; i++) {
+        if (strcmp(shares[i].name, name) == 0) {
+            return i;
+        }
+    }
+    if (!create || num_shares >= MAX_SHARES) {
+        return 0; // Sem espaço: cai no remetente padrão
+    }
+    Share *share = &shares[num_shares];
+    memset(share, 0, sizeof(*share));
+    snprintf(share->name, JOB_NAME_LEN, "%s", name);
+    share->weight = 1;
+    return num_shares++;
+}
+
+int pending_before(const PendingJob *a, const PendingJob *b) {
+    if (a->priority != b->priority) {
+        return a->priority > b->priority;
+    }
+    if (a->deadline_ns != b->deadline_ns) {
+        return a->deadline_ns < b->deadline_ns;
+    }
+    if (a->tag != b->tag) {
+        return a->tag < b->tag;
+    }
+    return a->seq < b->seq;
+}
+
+void heap_sift_up(int i) {
+    PendingJob job = admission_queue[i];
+    while (i > 0 && pending_before(&job, &admission_queue[(i - 1) / 2])) {
+        admission_queue[i] = admission_queue[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    admission_queue[i] = job;
+}
+
+void heap_sift_down(int i) {
+    PendingJob job = admission_queue[i];
+    while (2 * i + 1 < admission_len) {
+        int child = 2 * i + 1;
+        if (child + 1 < admission_len && pending_before(&admission_queue[child + 1], &admission_queue[child])) {
+            child++;
+        }
+        if (!pending_before(&admission_queue[child], &job)) {
+            break;
+        }
+        admission_queue[i] = admission_queue[child];
+        i = child;
+    }
+    admission_queue[i] = job;
+}
+
+// Enfileira o comando com a chave tirada dos prefixos prio:, deadline: e
+// share:, que ficam no comando e são descartados no lançamento. A marca de
+// um remetente avança 1/peso a cada comando, a partir do relógio virtual da
+// fila (a marca do último que saiu): quem ficou ocioso não acumula crédito.
+int enqueue_background(const char *command, int group_id) {
+    if (admission_len >= ADMISSION_QUEUE_MAX) {
+        return -1;
+    }
+    if (admission_len == admission_cap) {
+        int cap = admission_cap > 0 ? admission_cap * 2 : MAX_QUEUED_JOBS;
+        PendingJob *queue = realloc(admission_queue, cap * sizeof(PendingJob));
+        if (queue == NULL) {
+            return -1;
+        }
+        admission_queue = queue;
+        admission_cap = cap;
+    }
+    char options[MAX_BUFFER];
+    snprintf(options, sizeof(options), "%s", command);
+    JobOptions opts;
+    parse_job_options(options, &opts);
+
+    PendingJob job;
+    job.command = strdup(command);
+    if (job.command == NULL || queued_count_add(group_id, 1) < 0) {
+        free(job.command);
+        return -1;
+    }
+    job.priority = opts.priority;
+    job.group_id = group_id;
+    job.deadline_ns = opts.deadline_ms > 0 ? mono_ns() + opts.deadline_ms * 1000000LL : INT64_MAX;
+    job.seq = admission_seq++;
+    job.share = opts.share != NULL ? find_share(opts.share, 1) : 0;
+    Share *share = &shares[job.share];
+    share->finish = (share->finish > admission_vclock ? share->finish : admission_vclock) + SHARE_SCALE / share->weight;
+    share->queued++;
+    job.tag = share->finish;
+    admission_queue[admission_len++] = job;
+    heap_sift_up(admission_len - 1);
+    return 0;
+}
+
+// Tira o primeiro da fila; o comando passa a ser de quem chamou
+PendingJob dequeue_background() {
+    PendingJob job = admission_queue[0];
+    admission_queue[0] = admission_queue[--admission_len];
+    if (admission_len > 0) {
+        heap_sift_down(0);
+    }
+    queued_count_add(job.group_id, -1);
+    admission_vclock = job.tag > admission_vclock ? job.tag : admission_vclock;
+    shares[job.share].queued--;
+    shares[job.share].launched++;
+    if (job.deadline_ns != INT64_MAX && mono_ns() > job.deadline_ns) {
+        admission_missed++;
+    }
+    return job;
+}
+
+ProcessGroup *find_bg_group(int id) {
+    for (int i = 0; i < num_bg_process_groups; i++) {
+        if (bg_process_groups[i].id == id) {
+            return &bg_process_groups[i];
+        }
+    }
+    return NULL;
+}
+
+// Lança os comandos enfileirados enquanto a admissão permitir. Um comando
+// volta ao grupo de origem; se este já tiver terminado, o grupo é recriado.
+void drain_admission_queue() {
+    while (admission_len > 0 && admission_blocker() == NULL) {
+        ProcessGroup *group = find_bg_group(admission_queue[0].group_id);
+        if (group == NULL) {
+            if (num_bg_process_groups >= MAX_PROCESSES) {
+                return; // Tentar de novo quando algum grupo terminar
+            }
+            group = &bg_process_groups[num_bg_process_groups++];
+            memset(group, 0, sizeof(*group));
+            group->id = admission_queue[0].group_id;
+            group->deadline_timer = -1;
+            start_group_deadline(group);
+        }
+        PendingJob job = dequeue_background();
+        consume_token();
+        launch_background(job.command, group);
+        free(job.command);
+    }
+}
+
+// Arrays de jobs: "array 1-10000%64 cmd" roda cmd uma vez por índice, com
+// FSH_TASK_ID no ambiente e no máximo 64 ao mesmo tempo. O array inteiro é
+// um único grupo na tabela de jobs, cujas posições são reaproveitadas à
+// medida que as tarefas terminam; o estado de cada tarefa fica em dois
+// bitmaps (concluída e falhou). As tarefas passam pela admissão como
+// qualquer comando em background.
+int parse_array_range(char *spec, JobArray *array) {
+    char *limit = strchr(spec, '%');
+    array->limit = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (limit != NULL) {
+        *limit++ = '\0';
+        array->limit = atoi(limit);
+    }
+    array->step = 1;
+    int n = sscanf(spec, "%ld-%ld:%ld", &array->start, &array->end, &array->step);
+    if (n == 1) {
+        array->end = array->start;
+    }
+    if (n < 1 || array->end < array->start || array->step < 1 || array->limit < 1) {
+        return -1;
+    }
+#if FSH_SECONDARY == FSH_SECONDARY_SIBLING
+    int max_limit = MAX_PROCESSES / 2; // Cada tarefa ocupa duas posições do grupo
+#else
+    int max_limit = MAX_PROCESSES;
+#endif
+    if (array->limit > max_limit) {
+        array->limit = max_limit;
+    }
+    array->total = (array->end - array->start) / array->step + 1;
+    return 0;
+}
+
+void array_create(char *args) {
+    while (*args == ' ') args++;
+    char *command = strchr(args, ' ');
+    if (command != NULL) {
+        *command++ = '\0';
+        while (*command == ' ') command++;
+    }
+    JobArray *array = NULL;
+    for (int i = 0; i < MAX_ARRAYS && array == NULL; i++) {
+        if (!job_arrays[i].active) {
+            array = &job_arrays[i];
+        }
+    }
+    if (array == NULL || num_bg_process_groups >= MAX_PROCESSES) {
+        printf("Número máximo de arrays ou grupos em background atingido\n");
+        return;
+    }
+    memset(array, 0, sizeof(*array));
+    if (command == NULL || *command == '\0' || parse_array_range(args, array) < 0) {
+        printf("Uso: array INICIO-FIM[:PASSO][%%LIMITE] comando\n");
+        return;
+    }
+    size_t words = (array->total + 63) / 64;
+    array->done_bits = calloc(words, sizeof(uint64_t));
+    array->failed_bits = calloc(words, sizeof(uint64_t));
+    if (array->done_bits == NULL || array->failed_bits == NULL) {
+        perror("Erro ao alocar o array");
+        free(array->done_bits);
+        free(array->failed_bits);
+        return;
+    }
+    snprintf(array->command, sizeof(array->command), "%s", command);
+
+    ProcessGroup *group = &bg_process_groups[num_bg_process_groups++];
+    memset(group, 0, sizeof(*group));
+    group->id = next_group_id++;
+    group->deadline_timer = -1;
+    group->array = (int)(array - job_arrays) + 1;
+    array->group_id = group->id;
+    array->active = 1;
+    start_group_deadline(group);
+    printf("[%d] array de %ld tarefas (%ld-%ld, passo %ld), até %d ao mesmo tempo\n", group->id, array->total,
+           array->start, array->end, array->step, array->limit);
+}
+
+// Registra o fim de uma tarefa; chamado pelo reaper para cada processo do grupo
+void array_task_finished(ProcessGroup *group, pid_t pid, int status) {
+    if (group->array == 0) {
+        return;
+    }
+    JobArray *array = &job_arrays[group->array - 1];
+    for (int i = 0; i < array->limit; i++) {
+        if (array->pids[i] == pid) {
+            long task = array->tasks[i];
+            array->done_bits[task / 64] |= 1ULL << (task % 64);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                array->failed_bits[task / 64] |= 1ULL << (task % 64);
+                array->failed++;
+            }
+            array->done++;
+            array->running--;
+            array->pids[i] = 0;
+            return;
+        }
+    }
+}
+
+int array_can_launch(JobArray *array, ProcessGroup *group) {
+    return !array->cancelled && array->next < array->total && array->running < array->limit &&
+           !group->stopped && group->paused_seq == 0 && !group->gang_paused;
+}
+
+// Há tarefas esperando só pela admissão (o loop deve acordar mais cedo)
+int arrays_waiting() {
+    for (int i = 0; i < MAX_ARRAYS; i++) {
+        ProcessGroup *group = job_arrays[i].active ? find_bg_group(job_arrays[i].group_id) : NULL;
+        if (group != NULL && array_can_launch(&job_arrays[i], group)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void array_finish(JobArray *array, ProcessGroup *group) {
+    notify_text("[%d] array concluído: %ld de %ld tarefas, %ld falharam\n", array->group_id, array->done,
+                array->total, array->failed);
+    free(array->done_bits);
+    free(array->failed_bits);
+    array->active = 0;
+    if (group != NULL) {
+        group->array = 0; // O grupo sai da tabela com o último processo
+    }
+}
+
+void run_arrays() {
+    int finished = 0;
+    for (int i = 0; i < MAX_ARRAYS; i++) {
+        JobArray *array = &job_arrays[i];
+        if (!array->active) {
+            continue;
+        }
+        ProcessGroup *group = find_bg_group(array->group_id);
+        if (group == NULL) {
+            array_finish(array, NULL);
+            continue;
+        }
+        while (array_can_launch(array, group) && admission_blocker() == NULL) {
+            if (group_live(group) == 0) {
+                group->pgid = 0; // O grupo de processos antigo acabou: a próxima tarefa cria outro
+            }
+            long task = array->next++;
+            char command[MAX_BUFFER];
+            snprintf(command, sizeof(command), "FSH_TASK_ID=%ld %s", array->start + task * array->step,
+                     array->command);
+            consume_token();
+            pid_t pid = launch_background(command, group);
+            int slot = 0;
+            while (slot < array->limit && array->pids[slot] != 0) slot++;
+            if (pid > 0 && group_slot(group, pid) >= 0) {
+                array->pids[slot] = pid;
+                array->tasks[slot] = task;
+                array->running++;
+            } else {
+                array->done_bits[task / 64] |= 1ULL << (task % 64);
+                array->failed_bits[task / 64] |= 1ULL << (task % 64);
+                array->done++;
+                array->failed++;
+            }
+        }
+        if ((array->next >= array->total || array->cancelled) && array->running == 0) {
+            array_finish(array, group);
+            finished = 1;
+        }
+    }
+    if (finished) {
+        // O reaper já compactou a tabela nesta volta; sem isto o grupo do
+        // array terminado ficaria nela até o próximo SIGCHLD, que pode não vir
+        compact_bg_groups();
+    }
+}
+
+void array_command(char *args) {
+    while (*args == ' ') args++;
+    if (*args != '\0' && *args != '%') {
+        array_create(args);
+        return;
+    }
+    ProcessGroup *only = *args == '%' ? find_job(args) : NULL;
+    for (int i = 0; i < MAX_ARRAYS; i++) {
+        JobArray *array = &job_arrays[i];
+        if (!array->active || (only != NULL && only->id != array->group_id)) {
+            continue;
+        }
+        printf("[%d] array %ld-%ld:%ld%%%d '%s': %ld/%ld concluídas, %ld falharam, %d rodando%s\n",
+               array->group_id, array->start, array->end, array->step, array->limit, array->command,
+               array->done, array->total, array->failed, array->running, array->cancelled ? " (cancelado)" : "");
+        if (only != NULL && array->failed > 0) {
+            printf("Tarefas que falharam:");
+            int shown = 0;
+            for (long t = 0; t < array->next && shown < 50; t++) {
+                if (array->failed_bits[t / 64] & (1ULL << (t % 64))) {
+                    printf(" %ld", array->start + t * array->step);
+                    shown++;
+                }
+            }
+            printf("%s\n", array->failed > shown ? " ..." : "");
+        }
+    }
+}
+
+// Supervisor: "restart:on-failure cmd" (ou always, never) mantém um job em
+// background de pé. Quando o reaper vê o processo terminar, o reinício é
+// agendado na roda de timers com backoff exponencial e jitter (metade do
+// atraso fixa, metade aleatória); um job que rodou mais que stable= volta ao
+// atraso inicial. Mais de max= reinícios dentro de window= abrem o disjuntor:
+// o job fica parado por cooldown= e então ganha uma única tentativa, que
+// fecha o disjuntor se durar e o reabre se cair logo. "health:'cmd'" roda a
+// verificação a cada health-every=; health-fails= falhas seguidas derrubam o
+// job com SIGTERM (e SIGKILL depois da carência), e ele é reiniciado como
+// qualquer falha. O grupo do job fica na tabela enquanto houver reinício
+// pendente, e os reinícios passam pela admissão.
+Supervised *supervise_find(int group_id, pid_t pid) {
+    for (int i = 0; i < MAX_SUPERVISED; i++) {
+        if (supervised[i].active && supervised[i].group_id == group_id && supervised[i].pid == pid) {
+            return &supervised[i];
+        }
+    }
+    return NULL;
+}
+
+void supervise_release(Supervised *sup) {
+    timer_cancel(sup->timer);
+    timer_cancel(sup->health_timer);
+    ProcessGroup *group = find_bg_group(sup->group_id);
+    if (group != NULL) {
+        group->supervised--; // O grupo sai da tabela com o último processo
+    }
+    sup->active = 0;
+}
+
+// Decide o que fazer com um job que terminou (ou nem chegou a ser lançado)
+void supervise_ended(Supervised *sup, int failed) {
+    int64_t now = mono_ns();
+    if (now - sup->started_ns >= supervisor.stable_ms * 1000000LL) {
+        sup->backoff_step = 0;
+        if (sup->half_open) { // A tentativa durou: o disjuntor fecha
+            sup->half_open = 0;
+            memset(sup->restart_ns, 0, sizeof(sup->restart_ns));
+        }
+    }
+    if (sup->policy == RESTART_NEVER || (sup->policy == RESTART_ON_FAILURE && !failed)) {
+        supervise_release(sup);
+        return;
+    }
+    int idx = (int)(sup - supervised);
+    int recent = 0;
+    for (int i = 0; i < SUPERVISE_MAX_RESTARTS; i++) {
+        recent += sup->restart_ns[i] != 0 && now - sup->restart_ns[i] < supervisor.window_ms * 1000000LL;
+    }
+    if (sup->half_open || recent >= supervisor.max_restarts) {
+        sup->state = SUP_BROKEN;
+        sup->half_open = 0;
+        sup->timer = timer_add(supervisor.cooldown_ms, sup->group_id, idx, 2);
+        notify_text("[%d] supervisor: '%s' reiniciado %d vezes em %.0fs, disjuntor aberto por %.0fs\n",
+                    sup->group_id, sup->name, recent, supervisor.window_ms / 1000.0, supervisor.cooldown_ms / 1000.0);
+        return;
+    }
+    int64_t delay = supervisor.backoff_ms;
+    for (int i = 0; i < sup->backoff_step && delay < supervisor.max_backoff_ms; i++) {
+        delay *= 2;
+    }
+    if (delay > supervisor.max_backoff_ms) {
+        delay = supervisor.max_backoff_ms;
+    }
+    sup->backoff_step++;
+    if (supervise_seed == 0) {
+        supervise_seed = (unsigned int)(mono_ns() ^ getpid());
+    }
+    delay = delay / 2 + rand_r(&supervise_seed) % (delay / 2 + 1);
+    sup->state = SUP_WAITING;
+    sup->timer = timer_add(delay, sup->group_id, idx, 2);
+    notify_text("[%d] supervisor: '%s' %s, reinício em %.1fs\n", sup->group_id, sup->name,
+                failed ? "falhou" : "terminou", delay / 1000.0);
+}
+
+// Chamado por launch_background para todo comando com restart:. Num
+// reinício a entrada já existe (SUP_LAUNCHING) e só recebe o novo PID.
+void supervise_started(const char *command, ProcessGroup *group, pid_t pid, JobOptions *opts) {
+    Supervised *sup = NULL;
+    for (int i = 0; i < MAX_SUPERVISED && sup == NULL; i++) {
+        if (supervised[i].active && supervised[i].state == SUP_LAUNCHING && supervised[i].group_id == group->id) {
+            sup = &supervised[i];
+        }
+    }
+    for (int i = 0; i < MAX_SUPERVISED && sup == NULL; i++) {
+        if (!supervised[i].active) {
+            sup = &supervised[i];
+            memset(sup, 0, sizeof(*sup));
+            sup->active = 1;
+            sup->policy = opts->restart;
+            sup->group_id = group->id;
+            sup->timer = sup->health_timer = -1;
+            snprintf(sup->command, sizeof(sup->command), "%s", command);
+            snprintf(sup->health, sizeof(sup->health), "%s", opts->health ? opts->health : "");
+            group->supervised++;
+        }
+    }
+    if (sup == NULL) {
+        printf("Número máximo de jobs supervisionados atingido, PID %d roda sem supervisão\n", pid);
+        return;
+    }
+    int slot = pid > 0 ? group_slot(group, pid) : -1;
+    if (slot >= 0) {
+        snprintf(sup->name, JOB_NAME_LEN, "%s", group->names[slot]);
+    }
+    sup->started_ns = mono_ns();
+    sup->health_failures = 0;
+    if (pid <= 0) {
+        if (sup->name[0] == '\0') {
+            snprintf(sup->name, JOB_NAME_LEN, "%s", command);
+        }
+        sup->pid = 0;
+        supervise_ended(sup, 1); // Lançamento falhou: conta como uma queda
+        return;
+    }
+    sup->state = SUP_RUNNING;
+    sup->pid = pid;
+    if (sup->health[0] != '\0' && supervisor.health_every_ms > 0) {
+        sup->health_timer = timer_add(supervisor.health_every_ms, group->id, (int)(sup - supervised), 3);
+    }
+}
+
+// Chamado pelo reaper para cada processo do grupo
+void supervise_exited(ProcessGroup *group, pid_t pid, int status) {
+    if (group->supervised == 0) {
+        return;
+    }
+    Supervised *sup = supervise_find(group->id, pid);
+    if (sup == NULL || (sup->state != SUP_RUNNING && sup->state != SUP_STOPPING)) {
+        return;
+    }
+    timer_cancel(sup->health_timer);
+    sup->health_timer = -1;
+    if (sup->state == SUP_STOPPING) {
+        supervise_release(sup);
+        return;
+    }
+    supervise_ended(sup, !WIFEXITED(status) || WEXITSTATUS(status) != 0);
+}
+
+// kill ou prazo do grupo: os jobs supervisionados dele não voltam mais
+void supervise_cancel_group(ProcessGroup *group) {
+    for (int i = 0; i < MAX_SUPERVISED && group->supervised > 0; i++) {
+        Supervised *sup = &supervised[i];
+        if (!sup->active || sup->group_id != group->id) {
+            continue;
+        }
+        if (sup->state == SUP_RUNNING) {
+            timer_cancel(sup->health_timer);
+            sup->health_timer = -1;
+            sup->state = SUP_STOPPING; // Sai da tabela quando o processo for reapado
+        } else if (sup->state != SUP_STOPPING) {
+            supervise_release(sup);
+        }
+    }
+}
+
+void supervise_launch(Supervised *sup) {
+    ProcessGroup *group = find_bg_group(sup->group_id);
+    if (group == NULL) {
+        sup->active = 0;
+        return;
+    }
+    if (group->stopped || group->paused_seq != 0 || admission_blocker() != NULL) {
+        sup->timer = timer_add(ADMISSION_POLL_MS, sup->group_id, (int)(sup - supervised), 2);
+        return; // Tentar de novo no próximo tick
+    }
+    if (group_live(group) == 0) {
+        group->pgid = 0; // O grupo de processos antigo acabou: o reinício cria outro
+    }
+    sup->restart_ns[sup->restarts % SUPERVISE_MAX_RESTARTS] = mono_ns();
+    sup->restarts++;
+    sup->state = SUP_LAUNCHING;
+    char command[MAX_BUFFER];
+    snprintf(command, sizeof(command), "%s", sup->command);
+    consume_token();
+    launch_background(command, group);
+    if (sup->state == SUP_LAUNCHING) {
+        supervise_release(sup); // O comando perdeu o restart: no caminho
+    }
+}
+
+void supervise_health_start(Supervised *sup) {
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("Erro no fork da verificação de saúde");
+        return;
+    }
+    if (pid == 0) {
+        join_process_group(0);
+        signal(SIGINT, SIG_IGN);
+        apply_sched_class(&bg_sched_class);
+        int null = open("/dev/null", O_WRONLY);
+        if (null >= 0) {
+            dup2(null, STDOUT_FILENO);
+            close(null);
+        }
+        launcher_exec(sup->health, NULL);
+        _exit(127);
+    }
+    sup->health_pid = pid; // Reapado pela varredura de órfãos do reaper
+}
+
+void supervise_timer(TimerNode *t) {
+    Supervised *sup = &supervised[t->pid];
+    if (!sup->active || sup->group_id != t->group_id) {
+        return;
+    }
+    if (t->stage == 2) {
+        sup->timer = -1;
+        if (sup->state == SUP_BROKEN) {
+            sup->half_open = 1;
+            notify_text("[%d] supervisor: nova tentativa de '%s' depois do disjuntor\n", sup->group_id, sup->name);
+        }
+        if (sup->state == SUP_WAITING || sup->state == SUP_BROKEN) {
+            supervise_launch(sup);
+        }
+        return;
+    }
+    sup->health_timer = -1;
+    if (sup->state != SUP_RUNNING) {
+        return;
+    }
+    if (sup->health_pid != 0) {
+        kill(sup->health_pid, SIGKILL); // Verificação travada: o reap conta como falha
+    } else {
+        supervise_health_start(sup);
+    }
+    sup->health_timer = timer_add(supervisor.health_every_ms, sup->group_id, t->pid, 3);
+}
+
+// Fim de um processo que não está em nenhum grupo: pode ser uma verificação
+void supervise_health_done(pid_t pid, int status) {
+    for (int i = 0; i < MAX_SUPERVISED; i++) {
+        Supervised *sup = &supervised[i];
+        if (!sup->active || sup->health_pid != pid) {
+            continue;
+        }
+        sup->health_pid = 0;
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+            sup->health_failures = 0;
+            return;
+        }
+        if (++sup->health_failures < supervisor.health_fails || sup->state != SUP_RUNNING) {
+            return;
+        }
+        sup->health_failures = 0;
+        notify_text("[%d] supervisor: '%s' (PID %d) falhou %d verificações de saúde, enviando SIGTERM\n",
+                    sup->group_id, sup->name, sup->pid, supervisor.health_fails);
+        kill(sup->pid, SIGTERM);
+        ProcessGroup *group = find_bg_group(sup->group_id);
+        int slot = group != NULL ? group_slot(group, sup->pid) : -1;
+        if (slot >= 0) {
+            timer_cancel(group->timers[slot]);
+            group->timers[slot] = timer_add(job_timeouts.grace_ms, group->id, sup->pid, 1);
+        }
+        return;
+    }
+}
+
+double supervise_timer_left(int id) {
+    if (id < 0 || !timer_pool[id].in_use) {
+        return 0;
+    }
+    return (timer_pool[id].expire - wheel_current_tick()) * (TIMER_TICK_NS / 1e9);
+}
+
+// Linhas do jobs para os supervisionados do grupo que estão fora do ar
+void supervise_jobs_lines(ProcessGroup *group) {
+    for (int i = 0; i < MAX_SUPERVISED && group->supervised > 0; i++) {
+        Supervised *sup = &supervised[i];
+        if (!sup->active || sup->group_id != group->id) {
+            continue;
+        }
+        if (sup->state == SUP_WAITING) {
+            printf("[%d]%s%s -  %s  (reinício em %.1fs)\n", group->id, group->label[0] ? " %" : "", group->label,
+                   sup->name, supervise_timer_left(sup->timer));
+        } else if (sup->state == SUP_BROKEN) {
+            printf("[%d]%s%s -  %s  (disjuntor aberto, nova tentativa em %.0fs)\n", group->id,
+                   group->label[0] ? " %" : "", group->label, sup->name, supervise_timer_left(sup->timer));
+        }
+    }
+}
+
+// supervise [max=N] [window=S] [cooldown=S] [backoff=S] [max-backoff=S] [stable=S]
+//           [health-every=S] [health-fails=N]
+// supervise stop %job | reset %job
+void supervise_command(char *args) {
+    while (*args == ' ') args++;
+    if (strncmp(args, "stop ", 5) == 0 || strncmp(args, "reset ", 6) == 0) {
+        int stop = args[0] == 's';
+        ProcessGroup *group = find_job(args + (stop ? 5 : 6));
+        if (group == NULL || group->supervised == 0) {
+            printf("Uso: supervise stop|reset %%job (job supervisionado não encontrado)\n");
+            return;
+        }
+        int id = group->id;
+        for (int i = 0; i < MAX_SUPERVISED; i++) {
+            Supervised *sup = &supervised[i];
+            if (!sup->active || sup->group_id != id) {
+                continue;
+            }
+            if (stop) {
+                supervise_release(sup); // O processo segue como um job comum
+                continue;
+            }
+            sup->backoff_step = 0;
+            sup->half_open = 0;
+            memset(sup->restart_ns, 0, sizeof(sup->restart_ns));
+            if (sup->state == SUP_WAITING || sup->state == SUP_BROKEN) {
+                timer_cancel(sup->timer);
+                sup->timer = -1;
+                supervise_launch(sup);
+            }
+        }
+        printf("[%d] supervisão %s\n", id, stop ? "encerrada" : "reiniciada");
+        return;
+    }
+    char *save;
+    for (char *arg = strtok_r(args, " ", &save); arg; arg = strtok_r(NULL, " ", &save)) {
+        char *value = strchr(arg, '=');
+        if (value == NULL) {
+            printf("Uso: supervise [max=N] [window=S] [cooldown=S] [backoff=S] [max-backoff=S] [stable=S] "
+                   "[health-every=S] [health-fails=N] | stop %%job | reset %%job\n");
+            return;
+        }
+        *value++ = '\0';
+        int64_t ms = (int64_t)(atof(value) * 1000);
+        if (strcmp(arg, "max") == 0) {
+            int max = atoi(value);
+            supervisor.max_restarts = max < 1 ? 1 : max > SUPERVISE_MAX_RESTARTS ? SUPERVISE_MAX_RESTARTS : max;
+        } else if (strcmp(arg, "window") == 0) {
+            supervisor.window_ms = ms;
+        } else if (strcmp(arg, "cooldown") == 0) {
+            supervisor.cooldown_ms = ms;
+        } else if (strcmp(arg, "backoff") == 0) {
+            supervisor.backoff_ms = ms > 0 ? ms : 1;
+        } else if (strcmp(arg, "max-backoff") == 0) {
+            supervisor.max_backoff_ms = ms;
+        } else if (strcmp(arg, "stable") == 0) {
+            supervisor.stable_ms = ms;
+        } else if (strcmp(arg, "health-every") == 0) {
+            supervisor.health_every_ms = ms;
+        } else if (strcmp(arg, "health-fails") == 0) {
+            supervisor.health_fails = atoi(value) > 0 ? atoi(value) : 1;
+        } else {
+            printf("Parâmetro desconhecido: %s\n", arg);
+            return;
+        }
+    }
+    printf("Disjuntor: %d reinícios em %.0fs, aberto por %.0fs; backoff %.1fs até %.0fs, zerado depois de %.0fs; "
+           "saúde a cada %.1fs, %d falhas derrubam o job\n",
+           supervisor.max_restarts, supervisor.window_ms / 1000.0, supervisor.cooldown_ms / 1000.0,
+           supervisor.backoff_ms / 1000.0, supervisor.max_backoff_ms / 1000.0, supervisor.stable_ms / 1000.0,
+           supervisor.health_every_ms / 1000.0, supervisor.health_fails);
+    static const char *states[] = { "rodando", "lançando", "aguardando reinício", "disjuntor aberto", "parando" };
+    for (int i = 0; i < MAX_SUPERVISED; i++) {
+        Supervised *sup = &supervised[i];
+        if (!sup->active) {
+            continue;
+        }
+        static const char *policies[] = { "never", "on-failure", "always" };
+        printf("[%d] %-10s %s", sup->group_id, policies[sup->policy], states[sup->state]);
+        if (sup->state == SUP_RUNNING) {
+            printf(" (PID %d, há %.1fs)", sup->pid, (mono_ns() - sup->started_ns) / 1e9);
+        } else if (sup->timer >= 0) {
+            printf(" (%.1fs)", supervise_timer_left(sup->timer));
+        }
+        printf("  %d reinícios%s%s  %s\n", sup->restarts, sup->health[0] ? ", saúde: " : "", sup->health, sup->name);
+    }
+}
+
+// Trabalhadores: "workers start N" cria N processos fsh, cada um ligado ao
+// coordenador por um socket Unix (SOCK_SEQPACKET, uma mensagem por
+// datagrama). "remote cmd" entrega o comando ao trabalhador menos carregado,
+// que o guarda na própria fila e o lança como um comando em background
+// (admissão, placement e classe de escalonamento dele), com o próprio reaper.
+// Um trabalhador ocioso pede trabalho; o coordenador rouba a metade mais
+// nova da fila do mais carregado e a repassa. Mensagens:
+//   coordenador -> trabalhador: job ID CMD, steal N, quit
+//   trabalhador -> coordenador: give ID CMD, load FILA RODANDO, done ID FALHOU CMD
+int worker_send(int fd, const char *fmt, ...) {
+    char msg[MAX_BUFFER + 64];
+    va_list ap;
+    va_start(ap, fmt);
+    int len = vsnprintf(msg, sizeof(msg), fmt, ap);
+    va_end(ap);
+    if (len >= (int)sizeof(msg)) {
+        len = sizeof(msg) - 1;
+    }
+    if (send(fd, msg, len, MSG_NOSIGNAL) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+// workers start N [node=auto] [cgroup=DIR] [slots=N]
+void workers_start(char *args) {
+    char *save;
+    int count = 0, slots = 0, by_node = 0;
+    const char *cgroup = NULL;
+    for (char *arg = strtok_r(args, " ", &save); arg; arg = strtok_r(NULL, " ", &save)) {
+        if (strcmp(arg, "node=auto") == 0) by_node = 1;
+        else if (strncmp(arg, "cgroup=", 7) == 0) cgroup = arg + 7;
+        else if (strncmp(arg, "slots=", 6) == 0) slots = atoi(arg + 6);
+        else if (count == 0 && atoi(arg) > 0) count = atoi(arg);
+        else count = -1;
+    }
+    if (count <= 0 || slots < 0) {
+        printf("Uso: workers start N [node=auto] [cgroup=DIR] [slots=N]\n");
+        return;
+    }
+    if (by_node) {
+        load_topology();
+    }
+    for (int n = 0; n < count; n++) {
+        if (num_workers >= MAX_WORKERS) {
+            printf("Número máximo de trabalhadores atingido\n");
+            return;
+        }
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) < 0) {
+            perror("Erro ao criar o socket do trabalhador");
+            return;
+        }
+        Worker *w = &workers[num_workers];
+        memset(w, 0, sizeof(*w));
+        w->id = num_workers + 1;
+        w->node = by_node ? num_workers % placement.num_nodes : -1;
+        if (cgroup != NULL) {
+            snprintf(w->cgroup, sizeof(w->cgroup), "%s/fsh-worker-%d", cgroup, w->id);
+            if (mkdir(w->cgroup, 0755) < 0 && errno != EEXIST) {
+                perror("Erro ao criar o cgroup do trabalhador");
+            }
+        }
+        // Fork duplo com a shell fora do modo subreaper: o trabalhador fica com
+        // o init e não aparece em waitall; o fim dele chega como EOF no socket
+        prctl(PR_SET_CHILD_SUBREAPER, 0);
+        pid_t pid = fork();
+        if (pid == 0 && fork() != 0) {
+            _exit(0);
+        }
+        if (pid == 0) {
+            setpgid(0, 0); // Ctrl-C e Ctrl-Z do terminal são só do coordenador
+            if (w->cgroup[0] != '\0') {
+                char path[sizeof(w->cgroup) + 16];
+                snprintf(path, sizeof(path), "%s/cgroup.procs", w->cgroup);
+                int fd = open(path, O_WRONLY);
+                if (fd < 0 || write(fd, "0", 1) < 0) {
+                    perror("Erro ao entrar no cgroup do trabalhador");
+                }
+                if (fd >= 0) close(fd);
+            }
+            if (w->node >= 0) {
+                cpu_set_t cpus;
+                node_cpus_allowed(w->node, &cpus);
+                apply_placement(&cpus, w->node);
+            }
+            char value[16];
+            fcntl(sv[1], F_SETFD, 0); // Esta ponta atravessa o exec
+            snprintf(value, sizeof(value), "%d", sv[1]);
+            setenv("FSH_WORKER_FD", value, 1);
+            snprintf(value, sizeof(value), "%d", slots);
+            setenv("FSH_WORKER_SLOTS", value, 1);
+            execl("/proc/self/exe", "fsh", (char *)NULL);
+            perror("Erro ao executar o trabalhador");
+            _exit(1);
+        }
+        close(sv[1]);
+        if (pid > 0) {
+            waitpid(pid, NULL, 0);
+        }
+        prctl(PR_SET_CHILD_SUBREAPER, 1);
+        if (pid < 0) {
+            perror("Erro no fork do trabalhador");
+            close(sv[0]);
+            return;
+        }
+        w->fd = sv[0];
+        w->slots = slots; // Corrigido pela mensagem "hello" do trabalhador
+        num_workers++;
+        if (w->node >= 0) {
+            printf("Trabalhador %d iniciado (nó %d)\n", w->id, placement.node_ids[w->node]);
+        } else {
+            printf("Trabalhador %d iniciado\n", w->id);
+        }
+    }
+}
+
+Worker *least_loaded_worker(Worker *except) {
+    Worker *best = NULL;
+    for (int i = 0; i < num_workers; i++) {
+        Worker *w = &workers[i];
+        if (w == except || w->fd < 0) {
+            continue;
+        }
+        // Carga relativa aos slots; antes do primeiro "load" vale 1 slot
+        double load = (double)(w->queued + w->running) / (w->slots > 0 ? w->slots : 1);
+        double best_load = best ? (double)(best->queued + best->running) / (best->slots > 0 ? best->slots : 1) : 0;
+        if (best == NULL || load < best_load) {
+            best = w;
+        }
+    }
+    return best;
+}
+
+void remote_dispatch(const char *command, int id) {
+    Worker *w = least_loaded_worker(NULL);
+    if (w == NULL) {
+        printf("Nenhum trabalhador; use workers start N\n");
+        return;
+    }
+    if (worker_send(w->fd, "job %d %s", id, command) < 0) {
+        perror("Erro ao enviar job ao trabalhador");
+        return;
+    }
+    w->queued++; // Estimativa até o próximo "load"
+    w->dispatched++;
+    remote_pending++;
+    printf("[remoto %d] '%s' enviado ao trabalhador %d\n", id, command, w->id);
+}
+
+// Um trabalhador com slots livres e fila vazia rouba de quem tem fila
+void workers_balance() {
+    for (int i = 0; i < num_workers; i++) {
+        Worker *thief = &workers[i];
+        if (thief->fd < 0 || thief->queued > 0 || thief->running >= thief->slots || thief->steal_from != 0) {
+            continue;
+        }
+        Worker *victim = NULL;
+        for (int j = 0; j < num_workers; j++) {
+            Worker *w = &workers[j];
+            if (w != thief && w->fd >= 0 && w->queued > 0 && w->stolen_by == 0 &&
+                (victim == NULL || w->queued > victim->queued)) {
+                victim = w;
+            }
+        }
+        if (victim == NULL) {
+            return; // Ninguém tem fila
+        }
+        int n = (victim->queued + 1) / 2;
+        if (n > thief->slots - thief->running) {
+            n = thief->slots - thief->running;
+        }
+        if (worker_send(victim->fd, "steal %d", n) == 0) {
+            victim->stolen_by = thief->id;
+            thief->steal_from = victim->id;
+        }
+    }
+}
+
+void worker_gone(Worker *w) {
+    printf("\nTrabalhador %d (PID=%d) saiu com %d jobs na fila e %d rodando\n", w->id, w->pid, w->queued, w->running);
+    remote_pending -= w->queued + w->running;
+    close(w->fd);
+    w->fd = -1;
+    for (int i = 0; i < num_workers; i++) {
+        if (workers[i].steal_from == w->id) workers[i].steal_from = 0;
+        if (workers[i].stolen_by == w->id) workers[i].stolen_by = 0;
+    }
+}
+
+void worker_message(Worker *w, char *msg) {
+    int id, a, b, off = 0;
+    if (sscanf(msg, "load %d %d", &a, &b) == 2) {
+        w->queued = a;
+        w->running = b;
+        if (w->stolen_by != 0) { // Resposta a um steal: todos os give já chegaram
+            workers[w->stolen_by - 1].steal_from = 0;
+            w->stolen_by = 0;
+        }
+    } else if (sscanf(msg, "hello %d %d", &a, &b) == 2) {
+        w->pid = a;
+        w->slots = b;
+    } else if (sscanf(msg, "give %d %n", &id, &off) == 1 && off > 0) {
+        Worker *thief = w->stolen_by ? &workers[w->stolen_by - 1] : NULL;
+        if (thief == NULL || thief->fd < 0) {
+            thief = least_loaded_worker(w);
+        }
+        if (thief == NULL || worker_send(thief->fd, "job %d %s", id, msg + off) < 0) {
+            thief = w; // Volta para quem tinha
+            worker_send(w->fd, "job %d %s", id, msg + off);
+        }
+        thief->queued++;
+        if (thief != w) {
+            thief->stolen++;
+        }
+    } else if (sscanf(msg, "done %d %d %n", &id, &a, &off) == 2 && off > 0) {
+        w->done++;
+        w->failed += a;
+        remote_pending--;
+        notify_text("[remoto %d] '%s' %s no trabalhador %d\n", id, msg + off, a ? "falhou" : "terminou", w->id);
+    }
+}
+
+int workers_poll_fds(struct pollfd *pfds) {
+    for (int i = 0; i < num_workers; i++) {
+        pfds[i].fd = workers[i].fd; // Negativo: ignorado pelo poll
+        pfds[i].events = POLLIN;
+        pfds[i].revents = 0;
+    }
+    return num_workers;
+}
+
+void workers_pump(struct pollfd *pfds) {
+    char msg[MAX_BUFFER + 64];
+    for (int i = 0; i < num_workers; i++) {
+        if (workers[i].fd < 0 || !(pfds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+            continue;
+        }
+        ssize_t n;
+        while ((n = recv(workers[i].fd, msg, sizeof(msg) - 1, MSG_DONTWAIT)) > 0) {
+            msg[n] = '\0';
+            worker_message(&workers[i], msg);
+        }
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+            worker_gone(&workers[i]);
+        }
+    }
+    workers_balance();
+}
+
+void workers_stop() {
+    char msg[MAX_BUFFER + 64];
+    for (int i = 0; i < num_workers; i++) {
+        if (workers[i].fd >= 0) {
+            worker_send(workers[i].fd, "quit");
+        }
+    }
+    // O trabalhador mata os próprios jobs antes de sair; o EOF marca o fim.
+    // Quem não responder até o prazo é morto com SIGKILL.
+    int64_t deadline = mono_ns() + WORKER_STOP_TIMEOUT_MS * 1000000LL;
+    for (int i = 0; i < num_workers; i++) {
+        while (workers[i].fd >= 0) {
+            int64_t left = deadline - mono_ns();
+            struct pollfd pfd = { .fd = workers[i].fd, .events = POLLIN };
+            int ready = left > 0 ? poll(&pfd, 1, (int)((left + 999999) / 1000000)) : 0;
+            if (ready < 0 && errno == EINTR) {
+                continue;
+            }
+            if (ready <= 0) {
+                printf("Trabalhador %d não respondeu ao quit, enviando SIGKILL\n", workers[i].id);
+                kill(workers[i].pid, SIGKILL);
+                break;
+            }
+            ssize_t n = recv(workers[i].fd, msg, sizeof(msg) - 1, 0);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            msg[n] = '\0';
+            worker_message(&workers[i], msg);
+        }
+        if (workers[i].fd >= 0) {
+            close(workers[i].fd);
+        }
+    }
+    num_workers = 0;
+    remote_pending = 0;
+}
+
+// workers [start N ...|stop]
+void workers_command(char *args) {
+    while (*args == ' ') args++;
+    if (strncmp(args, "start", 5) == 0) {
+        workers_start(args + 5);
+        return;
+    }
+    if (strcmp(args, "stop") == 0) {
+        workers_stop();
+        return;
+    }
+    if (*args != '\0') {
+        printf("Uso: workers [start N [node=auto] [cgroup=DIR] [slots=N]|stop]\n");
+        return;
+    }
+    printf("%-4s %8s %6s %6s %7s %8s %8s %8s %8s\n", "id", "PID", "slots", "fila", "rodando", "enviados",
+           "roubados", "feitos", "falhas");
+    for (int i = 0; i < num_workers; i++) {
+        Worker *w = &workers[i];
+        printf("%-4d %8d %6d %6d %7d %8d %8d %8d %8d%s\n", w->id, w->pid, w->slots, w->queued, w->running,
+               w->dispatched, w->stolen, w->done, w->failed, w->fd < 0 ? "  (saiu)" : "");
+    }
+    printf("%d jobs remotos pendentes\n", remote_pending);
+}
+
+// Lado do trabalhador: fila local, lançamento até os slots e aviso de fim
+void worker_report(int force) {
+    int running = 0;
+    for (int i = 0; i < num_bg_process_groups; i++) {
+        running += bg_process_groups[i].remote != 0;
+    }
+    if (force || running != worker.reported_running || worker.len != worker.reported_queued) {
+        worker_send(worker.fd, "load %d %d", worker.len, running);
+        worker.reported_queued = worker.len;
+        worker.reported_running = running;
+    }
+}
+
+void worker_receive() {
+    char msg[MAX_BUFFER + 64];
+    ssize_t n;
+    while ((n = recv(worker.fd, msg, sizeof(msg) - 1, MSG_DONTWAIT)) > 0) {
+        msg[n] = '\0';
+        int id, count, off = 0;
+        if (sscanf(msg, "job %d %n", &id, &off) == 1 && off > 0 && worker.len < MAX_QUEUED_JOBS) {
+            QueuedJob *job = &worker.queue[(worker.head + worker.len++) % MAX_QUEUED_JOBS];
+            snprintf(job->command, sizeof(job->command), "%s", msg + off);
+            job->group_id = id;
+        } else if (sscanf(msg, "job %d", &id) == 1) {
+            worker_send(worker.fd, "done %d 1 %s", id, "(fila do trabalhador cheia)");
+        } else if (sscanf(msg, "steal %d", &count) == 1) {
+            // Os mais novos, do fim da fila: os mais antigos continuam aqui
+            while (count-- > 0 && worker.len > 0) {
+                QueuedJob *job = &worker.queue[(worker.head + --worker.len) % MAX_QUEUED_JOBS];
+                worker_send(worker.fd, "give %d %s", job->group_id, job->command);
+            }
+            worker_report(1);
+        } else if (strcmp(msg, "quit") == 0) {
+            worker.quit = 1;
+        }
+    }
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+        worker.quit = 1; // O coordenador saiu
+    }
+}
+
+void worker_launch_jobs() {
+    int running = 0;
+    for (int i = 0; i < num_bg_process_groups; i++) {
+        running += bg_process_groups[i].remote != 0;
+    }
+    while (worker.len > 0 && running < worker.slots && num_bg_process_groups < MAX_PROCESSES &&
+           admission_blocker() == NULL) {
+        QueuedJob *job = &worker.queue[worker.head];
+        worker.head = (worker.head + 1) % MAX_QUEUED_JOBS;
+        worker.len--;
+        ProcessGroup *group = &bg_process_groups[num_bg_process_groups++];
+        memset(group, 0, sizeof(*group));
+        group->id = next_group_id++;
+        group->deadline_timer = -1;
+        group->remote = job->group_id;
+        consume_token();
+        launch_background(job->command, group);
+        start_group_deadline(group);
+        running++;
+    }
+}
+
+// Chamado quando um grupo sai da tabela do trabalhador
+void worker_group_done(ProcessGroup *group) {
+    if (worker.slots > 0 && group->remote != 0) {
+        worker_send(worker.fd, "done %d %d %s", group->remote, group->failed > 0 || group->reaped == 0,
+                    group->count > 0 ? group->names[0] : "(não iniciado)");
+    }
+}
+
+void worker_main(int fd) {
+    signal(SIGINT, SIG_IGN); // O terminal é do coordenador
+    signal(SIGTSTP, SIG_IGN);
+    worker.fd = fd;
+    const char *slots = getenv("FSH_WORKER_SLOTS");
+    worker.slots = slots ? atoi(slots) : 0;
+    if (worker.slots <= 0) {
+        cpu_set_t cpus;
+        worker.slots = sched_getaffinity(0, sizeof(cpus), &cpus) == 0 ? CPU_COUNT(&cpus) : 1;
+    }
+    unsetenv("FSH_WORKER_FD"); // Os jobs não herdam
+    unsetenv("FSH_WORKER_SLOTS");
+    notifier.quiet = 1; // Os avisos ficam com o coordenador
+    job_log_open();
+    if (prctl(PR_SET_CHILD_SUBREAPER, 1) < 0) {
+        perror("Erro ao tornar o trabalhador subreaper");
+    }
+    wheel_init();
+    worker_send(fd, "hello %d %d", getpid(), worker.slots);
+    worker_report(1);
+
+    while (!worker.quit) {
+        struct pollfd pfds[2 + MAX_OUTPUT_STREAMS] = {
+            { .fd = fd, .events = POLLIN },
+            { .fd = wheel.fd, .events = POLLIN },
+        };
+        int nfds = 2 + output_poll_fds(pfds + 2);
+        int ready = poll(pfds, nfds, worker.len > 0 ? ADMISSION_POLL_MS : 1000);
+        if (ready > 0 && (pfds[0].revents & (POLLIN | POLLHUP | POLLERR))) {
+            worker_receive();
+        }
+        if (ready > 0 && (pfds[1].revents & POLLIN)) {
+            wheel_run();
+        }
+        if (ready > 0 && nfds > 2) {
+            output_pump(pfds + 2, 0);
+        }
+        reap_background_processes();
+        worker_launch_jobs();
+        notify_flush();
+        worker_report(0);
+    }
+    terminate_all_processes();
+    output_pump(NULL, 0);
+    exit(0);
+}
+
+// Proteção contra falta de memória. Quando a pressão de memória (PSI) ou a
+// memória disponível passam do limite, os grupos em background são suspensos
+// um a um com SIGSTOP, do menos usado recentemente (lru) ou do maior RSS
+// (rss), e voltam com SIGCONT na ordem inversa quando a pressão baixa. Uma
+// ação por MEMGUARD_STEP_NS dá tempo de o efeito aparecer nas médias.
+// Desligada por padrão: suspender jobs do usuário só com "memguard on".
+double read_mem_available_pct() {
+    FILE *file = fopen("/proc/meminfo", "r");
+    if (file == NULL) {
+        return 100;
+    }
+    char line[128];
+    long total = 0, avail = -1, v;
+    while (fgets(line, sizeof(line), file)) {
+        if (sscanf(line, "MemTotal: %ld", &v) == 1) total = v;
+        else if (sscanf(line, "MemAvailable: %ld", &v) == 1) avail = v;
+    }
+    fclose(file);
+    return total > 0 && avail >= 0 ? 100.0 * avail / total : 100;
+}
+
+long group_rss_pages(ProcessGroup *group) {
+    long rss = 0;
+    for (int i = 0; i < group->count; i++) {
+        if (group->pids[i] == 0) {
+            continue;
+        }
+        char path[64];
+        long size, resident;
+        snprintf(path, sizeof(path), "/proc/%d/statm", group->pids[i]);
+        FILE *file = fopen(path, "r");
+        if (file == NULL) {
+            continue;
+        }
+        if (fscanf(file, "%ld %ld", &size, &resident) == 2) {
+            rss += resident;
+        }
+        fclose(file);
+    }
+    return rss;
+}
+
+// Próximo grupo a suspender, ou NULL se todos já estão suspensos
+ProcessGroup *memguard_victim() {
+    ProcessGroup *victim = NULL;
+    long victim_rss = -1;
+    for (int i = 0; i < num_bg_process_groups; i++) {
+        ProcessGroup *group = &bg_process_groups[i];
+        if (group->paused_seq != 0 || group->stopped || group->gang_paused || group_live(group) == 0) {
+            continue; // Já parado ou sem processos: suspendê-lo não libera nada
+        }
+        if (memguard.order == MEMGUARD_RSS) {
+            long rss = group_rss_pages(group);
+            if (rss > victim_rss) {
+                victim = group;
+                victim_rss = rss;
+            }
+        } else if (victim == NULL || group->active_ns < victim->active_ns) {
+            victim = group;
+        }
+    }
+    return victim;
+}
+
+// Último grupo suspenso, que é o primeiro a voltar
+ProcessGroup *memguard_last_paused() {
+    ProcessGroup *last = NULL;
+    for (int i = 0; i < num_bg_process_groups; i++) {
+        if (bg_process_groups[i].paused_seq > (last ? last->paused_seq : 0)) {
+            last = &bg_process_groups[i];
+        }
+    }
+    return last;
+}
+
+void memguard_resume(ProcessGroup *group) {
+    if (!group->gang_paused && !group->stopped) { // Parado também pelo rodízio ou pelo usuário: continua parado
+        propagate_signal_to_group(group, SIGCONT);
+    }
+    group->paused_seq = 0;
+    group->active_ns = mono_ns();
+    memguard.paused--;
+}
+
+void memguard_check() {
+    int64_t now = mono_ns();
+    if (!memguard.enabled || now - memguard.acted_ns < MEMGUARD_STEP_NS) {
+        return;
+    }
+    if (read_pressure("/proc/pressure/memory", &memguard.pressure) < 0) {
+        memguard.pressure = 0;
+    }
+    memguard.available = read_mem_available_pct();
+
+    if (memguard.pressure > memguard.max_pressure || memguard.available < memguard.min_available) {
+        ProcessGroup *victim = memguard_victim();
+        if (victim != NULL) {
+            propagate_signal_to_group(victim, SIGSTOP);
+            victim->paused_seq = ++memguard.seq;
+            memguard.paused++;
+            memguard.acted_ns = now;
+            notify_text("Pressão de memória (%.2f, %.1f%% disponível): grupo [%d] suspenso\n",
+                        memguard.pressure, memguard.available, victim->id);
+        }
+    } else if (memguard.paused > 0 && memguard.pressure < memguard.resume_pressure &&
+               memguard.available > memguard.resume_available) {
+        ProcessGroup *group = memguard_last_paused();
+        if (group != NULL) {
+            memguard_resume(group);
+            memguard.acted_ns = now;
+            notify_text("Pressão de memória normalizada: grupo [%d] retomado\n", group->id);
+        }
+    }
+}
+
+void memguard_command(char *args) {
+    char *save;
+    for (char *arg = strtok_r(args, " ", &save); arg; arg = strtok_r(NULL, " ", &save)) {
+        char *eq = strchr(arg, '=');
+        double v = eq ? atof(eq + 1) : 0;
+        if (strcmp(arg, "on") == 0) memguard.enabled = 1;
+        else if (strcmp(arg, "off") == 0) memguard.enabled = 0;
+        else if (strcmp(arg, "lru") == 0) memguard.order = MEMGUARD_LRU;
+        else if (strcmp(arg, "rss") == 0) memguard.order = MEMGUARD_RSS;
+        else if (strncmp(arg, "psi=", 4) == 0) memguard.max_pressure = v;
+        else if (strncmp(arg, "resume-psi=", 11) == 0) memguard.resume_pressure = v;
+        else if (strncmp(arg, "avail=", 6) == 0) memguard.min_available = v;
+        else if (strncmp(arg, "resume-avail=", 13) == 0) memguard.resume_available = v;
+        else {
+            printf("Uso: memguard [on|off] [lru|rss] [psi=N] [resume-psi=N] [avail=N] [resume-avail=N]\n");
+            return;
+        }
+    }
+    if (!memguard.enabled) {
+        for (int i = 0; i < num_bg_process_groups; i++) {
+            if (bg_process_groups[i].paused_seq != 0) {
+                memguard_resume(&bg_process_groups[i]);
+            }
+        }
+    }
+    memguard.acted_ns = 0;
+    memguard_check();
+    printf("Proteção de memória %s (%s): PSI %.2f (suspende > %.2f, retoma < %.2f), "
+           "disponível %.1f%% (suspende < %.1f%%, retoma > %.1f%%), %d grupos suspensos\n",
+           memguard.enabled ? "ligada" : "desligada", memguard.order == MEMGUARD_RSS ? "rss" : "lru",
+           memguard.pressure, memguard.max_pressure, memguard.resume_pressure,
+           memguard.available, memguard.min_available, memguard.resume_available, memguard.paused);
+}
+
+// Escalonamento em gangue: com "gang K" no máximo K grupos em background
+// rodam ao mesmo tempo; os demais ficam parados com SIGSTOP no grupo
+// inteiro. A cada quantum o rodízio escolhe os K grupos que menos rodaram
+// até agora (menor serviço recebido), de modo que um job curto que acaba de
+// chegar entra logo e sai antes dos longos. Entre um quantum e outro só se
+// preenchem as vagas de quem terminou e se tira do ar o excedente, sem mexer
+// nos demais. Grupos parados pelo usuário ou pela proteção de memória e o
+// grupo em foreground ficam fora do rodízio.
+int gang_eligible(ProcessGroup *group) {
+    return group_live(group) > 0 && !group->stopped && group->paused_seq == 0 && group->id != gang.exempt_id;
+}
+
+int gang_compare(const void *a, const void *b) {
+    const ProcessGroup *x = &bg_process_groups[*(const int *)a], *y = &bg_process_groups[*(const int *)b];
+    if (x->gang_ns != y->gang_ns) {
+        return x->gang_ns < y->gang_ns ? -1 : 1;
+    }
+    return x->id - y->id; // Empate: o mais antigo primeiro
+}
+
+void gang_set(ProcessGroup *group, int paused) {
+    propagate_signal_to_group(group, paused ? SIGSTOP : SIGCONT);
+    group->gang_paused = paused;
+    gang.switches++;
+}
+
+// rotate = 1 no fim do quantum; 0 só acerta vagas e excedente
+void gang_schedule(int rotate) {
+    if (!gang.enabled) {
+        return;
+    }
+    int64_t now = mono_ns();
+    int order[MAX_PROCESSES];
+    int eligible = 0, running = 0;
+    for (int i = 0; i < num_bg_process_groups; i++) {
+        ProcessGroup *group = &bg_process_groups[i];
+        if (group->gang_paused && group_live(group) == 0) {
+            group->gang_paused = 0; // Nada para parar: deixa o array ou o supervisor lançar
+        }
+        if (!gang_eligible(group)) {
+            continue;
+        }
+        if (!group->gang_paused) {
+            group->gang_ns += now - gang.accounted_ns;
+            running++;
+        }
+        order[eligible++] = i;
+    }
+    gang.accounted_ns = now;
+    if (eligible == 0 || (!rotate && running == (eligible < gang.slots ? eligible : gang.slots))) {
+        return;
+    }
+    qsort(order, eligible, sizeof(int), gang_compare);
+    if (rotate) {
+        for (int k = 0; k < eligible; k++) {
+            ProcessGroup *group = &bg_process_groups[order[k]];
+            if ((k < gang.slots) == group->gang_paused) {
+                gang_set(group, k >= gang.slots);
+            }
+        }
+        gang.rotations++;
+    } else if (running > gang.slots) {
+        for (int k = eligible - 1; k >= 0 && running > gang.slots; k--) { // Sai quem mais rodou
+            if (!bg_process_groups[order[k]].gang_paused) {
+                gang_set(&bg_process_groups[order[k]], 1);
+                running--;
+            }
+        }
+    } else {
+        for (int k = 0; k < eligible && running < gang.slots; k++) { // Entra quem menos rodou
+            if (bg_process_groups[order[k]].gang_paused) {
+                gang_set(&bg_process_groups[order[k]], 0);
+                running++;
+            }
+        }
+    }
+    if (eligible > gang.slots && gang.timer < 0) {
+        gang.timer = timer_add(gang.quantum_ms, -1, 0, 4);
+    }
+}
+
+void gang_timer() {
+    gang.timer = -1;
+    gang_schedule(1);
+}
+
+void gang_check() {
+    gang_schedule(0);
+}
+
+void gang_stop() {
+    timer_cancel(gang.timer);
+    gang.timer = -1;
+    gang.enabled = 0;
+    for (int i = 0; i < num_bg_process_groups; i++) {
+        ProcessGroup *group = &bg_process_groups[i];
+        if (group->gang_paused) {
+            group->gang_paused = 0;
+            if (!group->stopped && group->paused_seq == 0) {
+                propagate_signal_to_group(group, SIGCONT);
+            }
+        }
+    }
+}
+
+// gang [on|off] [K] [quantum=MS]
+void gang_command(char *args) {
+    char *save;
+    for (char *arg = strtok_r(args, " ", &save); arg; arg = strtok_r(NULL, " ", &save)) {
+        if (strcmp(arg, "on") == 0) {
+            gang.enabled = 1;
+        } else if (strcmp(arg, "off") == 0) {
+            gang_stop();
+        } else if (strncmp(arg, "quantum=", 8) == 0 && atoi(arg + 8) > 0) {
+            gang.quantum_ms = atoi(arg + 8);
+        } else if (atoi(arg) > 0) {
+            gang.slots = atoi(arg);
+            gang.enabled = 1;
+        } else {
+            printf("Uso: gang [on|off] [K] [quantum=MS]\n");
+            return;
+        }
+    }
+    if (gang.enabled) {
+        if (gang.slots < 1) {
+            gang.slots = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        }
+        gang.accounted_ns = mono_ns();
+        gang_check();
+    }
+    int paused = 0;
+    for (int i = 0; i < num_bg_process_groups; i++) {
+        paused += bg_process_groups[i].gang_paused;
+    }
+    printf("Escalonamento em gangue %s: até %d grupos rodando, quantum de %lldms, %d grupos em espera, "
+           "%ld rodízios, %ld trocas\n", gang.enabled ? "ligado" : "desligado", gang.slots,
+           (long long)gang.quantum_ms, paused, gang.rotations, gang.switches);
+}
+
+// admission [on|off] [cpu=N] [mem=N] [io=N] [load=N] [rate=N] [burst=N]
+void admission_command(char *args) {
+    char *save;
+    for (char *arg = strtok_r(args, " ", &save); arg; arg = strtok_r(NULL, " ", &save)) {
+        char *eq = strchr(arg, '=');
+        double v = eq ? atof(eq + 1) : 0;
+        if (strcmp(arg, "on") == 0) admission.enabled = 1;
+        else if (strcmp(arg, "off") == 0) admission.enabled = 0;
+        else if (strncmp(arg, "cpu=", 4) == 0) admission.max_cpu = v;
+        else if (strncmp(arg, "mem=", 4) == 0) admission.max_memory = v;
+        else if (strncmp(arg, "io=", 3) == 0) admission.max_io = v;
+        else if (strncmp(arg, "load=", 5) == 0) admission.max_load = v;
+        else if (strncmp(arg, "rate=", 5) == 0 && v > 0) admission.rate = v;
+        else if (strncmp(arg, "burst=", 6) == 0 && v >= 1) admission.burst = admission.tokens = v;
+        else {
+            printf("Uso: admission [on|off] [cpu=N] [mem=N] [io=N] [load=N] [rate=N] [burst=N]\n");
+            return;
+        }
+    }
+    admission.sampled_ns = 0;
+    refresh_pressure();
+    refill_tokens();
+    printf("Admissão %s: cpu %.2f/%.2f, mem %.2f/%.2f, io %.2f/%.2f, load %.2f/%.2f\n",
+           admission.enabled ? "ligada" : "desligada",
+           admission.cpu, admission.max_cpu, admission.memory, admission.max_memory,
+           admission.io, admission.max_io, admission.load, admission.max_load);
+    printf("Taxa: %.1f/s (rajada %.0f, %.1f tokens), %d comandos na fila\n",
+           admission.rate, admission.burst, admission.tokens, admission_len);
+}
+
+// queue [share NOME=PESO ...]
+void queue_command(char *args) {
+    while (*args == ' ') args++;
+    if (strncmp(args, "share ", 6) == 0) {
+        char *save;
+        for (char *arg = strtok_r(args + 6, " ", &save); arg; arg = strtok_r(NULL, " ", &save)) {
+            char *eq = strchr(arg, '=');
+            if (eq == NULL || atoi(eq + 1) < 1) {
+                printf("Uso: queue share NOME=PESO ...\n");
+                return;
+            }
+            *eq = '\0';
+            int i = find_share(arg, 1);
+            if (i == 0 && arg[0] != '\0') {
+                printf("Número máximo de remetentes atingido\n");
+                return;
+            }
+            shares[i].weight = atoi(eq + 1);
+        }
+    } else if (*args != '\0') {
+        printf("Uso: queue [share NOME=PESO ...]\n");
+        return;
+    }
+    printf("%d comandos na fila de admissão, %ld saíram depois do prazo\n", admission_len, admission_missed);
+    if (admission_len > 0) {
+        PendingJob *next = &admission_queue[0];
+        printf("Próximo: '%s' (prioridade %d", next->command, next->priority);
+        if (next->deadline_ns != INT64_MAX) {
+            printf(", prazo em %.1fs", (next->deadline_ns - mono_ns()) / 1e9);
+        }
+        printf(")\n");
+    }
+    for (int i = 0; i < num_shares; i++) {
+        printf("  %-20s peso %3d  %ld na fila, %ld lançados\n", shares[i].name[0] ? shares[i].name : "(padrão)",
+               shares[i].weight, shares[i].queued, shares[i].launched);
+    }
+}
+
+void execute_background(char *command, ProcessGroup *group) {
+    // Remover espaços extras do comando
+    while (*command == ' ') command++;
+    char *end = command + strlen(command) - 1;
+    while (end > command && *end == ' ') end--;
+    *(end + 1) = '\0';
+
+    // Se já há fila, o comando entra nela e sai na ordem do heap
+    const char *blocker = admission_len > 0 ? "fila de admissão" : admission_blocker();
+    if (blocker != NULL) {
+        if (enqueue_background(command, group->id) < 0) {
+            printf("Fila de admissão cheia, comando '%s' descartado\n", command);
+        } else {
+            printf("Processo '%s' enfileirado (%s)\n", command, blocker);
+        }
+        return;
+    }
+    consume_token();
+    launch_background(command, group);
+}
+
+// Mata os filhos que a shell não conhece: órfãos adotados como subreaper,
+// como um Px' cujo Px já terminou. Cada um que morre pode entregar à shell
+// os próprios descendentes, por isso a varredura se repete até esvaziar.
+void kill_adopted_children() {
+    pid_t self = getpid();
+    for (int round = 0; round < 16; round++) {
+        DIR *dir = opendir("/proc");
+        if (dir == NULL) {
+            return;
+        }
+        int found = 0;
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            char path[300], buf[512];
+            snprintf(path, sizeof(path), "/proc/%s/stat", entry->d_name);
+            int fd = entry->d_name[0] >= '0' && entry->d_name[0] <= '9' ? open(path, O_RDONLY) : -1;
+            if (fd < 0) {
+                continue;
+            }
+            ssize_t n = read(fd, buf, sizeof(buf) - 1);
+            close(fd);
+            buf[n > 0 ? n : 0] = '\0';
+            char *p = strrchr(buf, ')'); // O nome do comando pode ter espaços
+            int ppid;
+            if (p != NULL && sscanf(p + 2, "%*c %d", &ppid) == 1 && ppid == self) {
+                pid_t pid = atoi(entry->d_name);
+                pid_t pgid = getpgid(pid);
+                kill(pid, SIGKILL);
+                if (pgid > 0 && pgid != getpgrp()) {
+                    killpg(pgid, SIGKILL);
+                }
+                waitpid(pid, NULL, 0);
+                found++;
+            }
+        }
+        closedir(dir);
+        if (found == 0) {
+            return;
+        }
+    }
+}
+
+void terminate_all_processes() {
+    if (fg_process_pid != 0) {
+        signal_job(fg_process_pid, SIGKILL); // Enviar sinal para o grupo de processos
+    }
+
+    for (int i = 0; i < num_bg_process_groups; i++) {
+        propagate_signal_to_group(&bg_process_groups[i], SIGKILL);
+    }
+
+    // Esperar que todos os processos terminem
+    for (int i = 0; i < num_bg_process_groups; i++) {
+        for (int j = 0; j < bg_process_groups[i].count; j++) {
+            if (bg_process_groups[i].pids[j] != 0) {
+                waitpid(bg_process_groups[i].pids[j], NULL, 0);
+            }
+        }
+    }
+    kill_adopted_children();
+    workers_stop();
+}
+
+// Marca como concluído um processo em background reapado fora do loop principal
+void mark_background_finished(pid_t pid, int status, struct rusage *ru) {
+    for (int i = 0; i < num_bg_process_groups; i++) {
+        ProcessGroup *group = &bg_process_groups[i];
+        for (int j = 0; j < group->count; j++) {
+            if (group->pids[j] == pid) {
+                notify_finished(group->id, pid, status);
+                if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                    group->failed++;
+                    group->exit_status = status;
+                }
+                group->reaped++;
+                group->cpu_ns += rusage_cpu_ns(ru);
+                array_task_finished(group, pid, status);
+                log_finished_job(pid, group->pgid, group->hashes[j], group->names[j], group->started_ns[j], status, ru);
+                metrics_reaped();
+                timer_cancel(group->timers[j]);
+                group->pids[j] = 0;
+                supervise_exited(group, pid, status);
+                return;
+            }
+        }
+    }
+    supervise_health_done(pid, status);
+}
+
+int find_dag_job(const char *name) {
+    for (int i = 0; i < num_dag_jobs; i++) {
+        if (strcmp(dag_jobs[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Lê o arquivo de jobs. Formato de cada linha:
+//   nome [after:dep1,dep2] [cost:N] -- comando
+// Linhas vazias e iniciadas por '#' são ignoradas.
+int load_dag_file(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        perror("Erro ao abrir arquivo de jobs");
+        return -1;
+    }
+
+    char line[MAX_BUFFER];
+    int line_no = 0;
+    num_dag_jobs = 0;
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        line_no++;
+        line[strcspn(line, "\n")] = '\0';
+
+        char *p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '\0' || *p == '#') {
+            continue;
+        }
+
+        char *sep = strstr(p, " -- ");
+        if (sep == NULL) {
+            fprintf(stderr, "%s:%d: faltando ' -- ' antes do comando\n", path, line_no);
+            fclose(f);
+            return -1;
+        }
+        *sep = '\0';
+        char *command = sep + 4;
+        while (*command == ' ') command++;
+
+        if (num_dag_jobs >= MAX_DAG_JOBS) {
+            fprintf(stderr, "%s:%d: número máximo de jobs (%d) atingido\n", path, line_no, MAX_DAG_JOBS);
+            fclose(f);
+            return -1;
+        }
+
+        DagJob *job = &dag_jobs[num_dag_jobs];
+        memset(job, 0, sizeof(*job));
+        job->cost = 1;
+
+        char *save;
+        char *token = strtok_r(p, " \t", &save);
+        snprintf(job->name, sizeof(job->name), "%s", token);
+        snprintf(job->command, sizeof(job->command), "%s", command);
+
+        while ((token = strtok_r(NULL, " \t", &save)) != NULL) {
+            if (strncmp(token, "after:", 6) == 0) {
+                char *dsave;
+                for (char *dep = strtok_r(token + 6, ",", &dsave); dep; dep = strtok_r(NULL, ",", &dsave)) {
+                    if (job->num_deps >= MAX_DAG_DEPS) {
+                        fprintf(stderr, "%s:%d: dependências demais\n", path, line_no);
+                        fclose(f);
+                        return -1;
+                    }
+                    snprintf(job->dep_names[job->num_deps++], MAX_DAG_NAME, "%s", dep);
+                }
+            } else if (strncmp(token, "cost:", 5) == 0) {
+                job->cost = atol(token + 5);
+                if (job->cost < 1) job->cost = 1;
+            } else {
+                fprintf(stderr, "%s:%d: atributo desconhecido '%s'\n", path, line_no, token);
+                fclose(f);
+                return -1;
+            }
+        }
+
+        if (find_dag_job(job->name) >= 0) {
+            fprintf(stderr, "%s:%d: job '%s' duplicado\n", path, line_no, job->name);
+            fclose(f);
+            return -1;
+        }
+        num_dag_jobs++;
+    }
+    fclose(f);
+
+    // Resolver nomes das dependências (permite referências adiante no arquivo)
+    for (int i = 0; i < num_dag_jobs; i++) {
+        for (int d = 0; d < dag_jobs[i].num_deps; d++) {
+            int dep = find_dag_job(dag_jobs[i].dep_names[d]);
+            if (dep < 0) {
+                fprintf(stderr, "Job '%s' depende de '%s', que não existe\n", dag_jobs[i].name, dag_jobs[i].dep_names[d]);
+                return -1;
+            }
+            dag_jobs[i].deps[d] = dep;
+        }
+        dag_jobs[i].remaining = dag_jobs[i].num_deps;
+    }
+    return num_dag_jobs;
+}
+
+// Calcula o caminho crítico de cada job (custo do job mais o maior caminho
+// entre seus dependentes), percorrendo o grafo em ordem topológica reversa.
+// Retorna -1 se houver ciclo.
+int compute_dag_ranks() {
+    int order[MAX_DAG_JOBS];
+    int indegree[MAX_DAG_JOBS];
+    int head = 0, tail = 0;
+
+    for (int i = 0; i < num_dag_jobs; i++) {
+        indegree[i] = dag_jobs[i].num_deps;
+        if (indegree[i] == 0) {
+            order[tail++] = i;
+        }
+    }
+    while (head < tail) {
+        int cur = order[head++];
+        for (int i = 0; i < num_dag_jobs; i++) {
+            for (int d = 0; d < dag_jobs[i].num_deps; d++) {
+                if (dag_jobs[i].deps[d] == cur && --indegree[i] == 0) {
+                    order[tail++] = i;
+                }
+            }
+        }
+    }
+    if (tail < num_dag_jobs) {
+        return -1;
+    }
+
+    for (int k = num_dag_jobs - 1; k >= 0; k--) {
+        DagJob *job = &dag_jobs[order[k]];
+        long longest = 0;
+        for (int i = 0; i < num_dag_jobs; i++) {
+            for (int d = 0; d < dag_jobs[i].num_deps; d++) {
+                if (dag_jobs[i].deps[d] == order[k] && dag_jobs[i].rank > longest) {
+                    longest = dag_jobs[i].rank;
+                }
+            }
+        }
+        job->rank = job->cost + longest;
+    }
+    return 0;
+}
+
+// Cancela recursivamente os jobs que dependem de um job que falhou
+int cancel_dag_dependents(int failed) {
+    int cancelled = 0;
+    for (int i = 0; i < num_dag_jobs; i++) {
+        if (dag_jobs[i].state != DAG_PENDENTE) {
+            continue;
+        }
+        for (int d = 0; d < dag_jobs[i].num_deps; d++) {
+            if (dag_jobs[i].deps[d] == failed) {
+                notify_text("[dag] '%s' cancelado (dependência '%s' falhou)\n", dag_jobs[i].name, dag_jobs[failed].name);
+                dag_jobs[i].state = DAG_CANCELADO;
+                cancelled += 1 + cancel_dag_dependents(i);
+                break;
+            }
+        }
+    }
+    return cancelled;
+}
+
+DagJob *find_dag_group(int id) {
+    for (int i = 0; dag_run.active && i < num_dag_jobs; i++) {
+        if (dag_jobs[i].state == DAG_EXECUTANDO && dag_jobs[i].group_id == id) {
+            return &dag_jobs[i];
+        }
+    }
+    return NULL;
+}
+
+// Lança o job como um grupo em background próprio, pelo mesmo caminho de
+// "cmd #": admissão, posicionamento, classe de escalonamento e grupo de
+// processos valem também para o DAG. Retorna 1 se a tabela de grupos está
+// cheia e o job deve esperar a próxima volta.
+int spawn_dag_job(DagJob *job) {
+    if (num_bg_process_groups >= MAX_PROCESSES) {
+        return 1;
+    }
+    char buffer[MAX_BUFFER];
+    snprintf(buffer, sizeof(buffer), "%s", job->command);
+    ProcessGroup group = { .count = 0, .id = next_group_id++, .deadline_timer = -1 };
+    snprintf(group.label, JOB_NAME_LEN, "%.*s", JOB_NAME_LEN - 1, job->name); // %nome acha o job do DAG
+    job->group_id = group.id;
+    job->state = DAG_EXECUTANDO;
+    job->started_ns = now_ns();
+    execute_background(buffer, &group);
+    if (group.count > 0) {
+        start_group_deadline(&group);
+        bg_process_groups[num_bg_process_groups++] = group;
+        notify_text("[dag] '%s' iniciado como [%d] (PID=%d, caminho crítico=%ld)\n", job->name, group.id,
+                    group.pids[0], job->rank);
+    } else if (queued_count(group.id) > 0) {
+        notify_text("[dag] '%s' na fila de admissão como [%d]\n", job->name, group.id);
+    } else {
+        job->group_id = 0;
+        return -1;
+    }
+    return 0;
+}
+
+// Fim do grupo de um job do DAG, chamado quando ele sai da tabela
+void dag_group_done(ProcessGroup *group) {
+    DagJob *job = find_dag_group(group->id);
+    if (job == NULL) {
+        return;
+    }
+    int idx = job - dag_jobs;
+    dag_run.running--;
+    dag_run.finished++;
+
+    if (group->failed == 0) {
+        notify_text("[dag] '%s' concluído\n", job->name);
+        job->state = DAG_OK;
+        dag_run.ok++;
+        for (int i = 0; i < num_dag_jobs; i++) {
+            for (int d = 0; d < dag_jobs[i].num_deps; d++) {
+                if (dag_jobs[i].deps[d] == idx) {
+                    dag_jobs[i].remaining--;
+                }
+            }
+        }
+    } else {
+        if (WIFSIGNALED(group->exit_status)) {
+            notify_text("[dag] '%s' terminado pelo sinal %d\n", job->name, WTERMSIG(group->exit_status));
+        } else {
+            notify_text("[dag] '%s' falhou (status=%d)\n", job->name, WEXITSTATUS(group->exit_status));
+        }
+        job->state = DAG_FALHOU;
+        dag_run.failed++;
+        int c = cancel_dag_dependents(idx);
+        dag_run.cancelled += c;
+        dag_run.finished += c;
+    }
+}
+
+// Um passo do DAG, a cada volta do loop principal (via tasks_run): inicia
+// todos os jobs cujas dependências foram satisfeitas, priorizando o maior
+// caminho crítico, sem ultrapassar max_parallel jobs simultâneos. Quem
+// reapa é o reaper; o fim de cada job chega por dag_group_done.
+void dag_step() {
+    if (!dag_run.active || dag_run.stopped) {
+        return;
+    }
+    int blocked = 0;
+    while (dag_run.running < dag_run.max_parallel) {
+        int best = -1;
+        for (int i = 0; i < num_dag_jobs; i++) {
+            if (dag_jobs[i].state == DAG_PENDENTE && dag_jobs[i].remaining == 0 &&
+                (best < 0 || dag_jobs[i].rank > dag_jobs[best].rank)) {
+                best = i;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+        int spawned = spawn_dag_job(&dag_jobs[best]);
+        if (spawned > 0) {
+            blocked = 1; // Sem vaga na tabela de grupos: tentar na próxima volta
+            break;
+        }
+        if (spawned < 0) {
+            dag_jobs[best].state = DAG_FALHOU;
+            dag_run.failed++;
+            dag_run.finished++;
+            int c = cancel_dag_dependents(best);
+            dag_run.cancelled += c;
+            dag_run.finished += c;
+            continue;
+        }
+        dag_run.running++;
+    }
+
+    if (dag_run.running == 0 && !blocked) {
+        notify_text("DAG concluído em %.1fs: %d ok, %d falharam, %d cancelados\n",
+                    (mono_ns() - dag_run.started_ns) / 1e9, dag_run.ok, dag_run.failed, dag_run.cancelled);
+        dag_run.active = 0;
+    }
+}
+
+// dag [-j N] arquivo: carrega o grafo e volta ao prompt; os jobs são
+// iniciados e acompanhados pelo loop principal
+void dag_start(const char *path, int max_parallel) {
+    if (dag_run.active) {
+        printf("Já há um DAG em execução (%d de %d jobs terminados)\n", dag_run.finished, num_dag_jobs);
+        return;
+    }
+    if (load_dag_file(path) < 0) {
+        return;
+    }
+    if (compute_dag_ranks() < 0) {
+        fprintf(stderr, "Erro: o grafo de jobs contém um ciclo\n");
+        return;
+    }
+    memset(&dag_run, 0, sizeof(dag_run));
+    dag_run.active = 1;
+    dag_run.max_parallel = max_parallel;
+    dag_run.started_ns = mono_ns();
+    printf("[dag] %d jobs, até %d em paralelo\n", num_dag_jobs, max_parallel);
+    dag_step();
+}
+
+// dag: andamento do DAG; dag cont: retoma um DAG suspenso com Ctrl-Z
+void dag_status(int resume) {
+    if (!dag_run.active) {
+        printf("Nenhum DAG em execução\n");
+        return;
+    }
+    if (resume && dag_run.stopped) {
+        for (int i = 0; i < num_bg_process_groups; i++) {
+            ProcessGroup *group = &bg_process_groups[i];
+            if (find_dag_group(group->id) != NULL && group->stopped) {
+                propagate_signal_to_group(group, SIGCONT);
+                group->stopped = 0;
+            }
+        }
+        dag_run.stopped = 0;
+        dag_step();
+    }
+    printf("[dag] %d de %d jobs terminados (%d ok, %d falharam, %d cancelados), %d em execução%s\n",
+           dag_run.finished, num_dag_jobs, dag_run.ok, dag_run.failed, dag_run.cancelled, dag_run.running,
+           dag_run.stopped ? ", suspenso" : "");
+    for (int i = 0; i < num_dag_jobs; i++) {
+        if (dag_jobs[i].state == DAG_EXECUTANDO) {
+            printf("  '%s' [%d] há %.1fs\n", dag_jobs[i].name, dag_jobs[i].group_id,
+                   (now_ns() - dag_jobs[i].started_ns) / 1e9);
+        }
+    }
+}
+
+// Espera o job em foreground sem deixar de atender a roda de timers: o
+// pidfd do filho fica legível quando ele termina. Retorna 1 se ele foi
+// suspenso com Ctrl-Z; sem pidfd, retorna 0 e o wait4 de quem chamou espera.
+int wait_foreground(pid_t pid) {
+    int pidfd = (int)syscall(SYS_pidfd_open, pid, 0);
+    if (pidfd < 0) {
+        return 0;
+    }
+    int stopped = 0;
+    fg_stop_requested = 0;
+    while (1) {
+        if (fg_stop_requested) {
+            stopped = 1;
+            break;
+        }
+        struct pollfd pfds[2 + MAX_OUTPUT_STREAMS] = {
+            { .fd = pidfd, .events = POLLIN },
+            { .fd = wheel.fd, .events = POLLIN },
+        };
+        int nfds = 2 + output_poll_fds(pfds + 2);
+        if (poll(pfds, nfds, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (pfds[1].revents & POLLIN) {
+            wheel_run();
+        }
+        if (nfds > 2) {
+            output_pump(pfds + 2, 0);
+        }
+        if (pfds[0].revents & POLLIN) {
+            break;
+        }
+    }
+    close(pidfd);
+    return stopped;
+}
+
+// Controle de jobs por grupo. Os comandos de uma mesma linha dividem um
+// grupo de processos (o do primeiro), então kill, stop, cont, fg e bg agem
+// sobre o job inteiro com um único killpg. Um job é indicado por %N (número
+// do grupo), %% (o mais recente), %nome (rótulo dado com o prefixo name:) ou
+// %prefixo (início do primeiro comando).
+ProcessGroup *find_job(const char *spec) {
+    if (spec == NULL || spec[0] != '%') {
+        return NULL;
+    }
+    spec++;
+    if (strcmp(spec, "%") == 0 || strcmp(spec, "+") == 0 || *spec == '\0') {
+        ProcessGroup *last = NULL;
+        for (int i = 0; i < num_bg_process_groups; i++) {
+            if (last == NULL || bg_process_groups[i].id > last->id) {
+                last = &bg_process_groups[i];
+            }
+        }
+        return last;
+    }
+    char *end;
+    long id = strtol(spec, &end, 10);
+    if (*end == '\0') {
+        return find_bg_group((int)id);
+    }
+    for (int i = 0; i < num_bg_process_groups; i++) {
+        if (strcmp(bg_process_groups[i].label, spec) == 0) {
+            return &bg_process_groups[i];
+        }
+    }
+    for (int i = 0; i < num_bg_process_groups; i++) {
+        if (strncmp(bg_process_groups[i].names[0], spec, strlen(spec)) == 0) {
+            return &bg_process_groups[i];
+        }
+    }
+    return NULL;
+}
+
+static const struct { const char *name; int sig; } signal_names[] = {
+    { "HUP", SIGHUP }, { "INT", SIGINT }, { "QUIT", SIGQUIT }, { "KILL", SIGKILL },
+    { "USR1", SIGUSR1 }, { "USR2", SIGUSR2 }, { "TERM", SIGTERM }, { "CONT", SIGCONT },
+    { "STOP", SIGSTOP }, { "TSTP", SIGTSTP },
+};
+
+const char *signal_name(int sig) {
+    for (size_t i = 0; i < sizeof(signal_names) / sizeof(signal_names[0]); i++) {
+        if (signal_names[i].sig == sig) {
+            return signal_names[i].name;
+        }
+    }
+    return "?";
+}
+
+int parse_signal(const char *name) {
+    char *end;
+    long sig = strtol(name, &end, 10);
+    if (*end == '\0' && sig > 0 && sig < NSIG) {
+        return (int)sig;
+    }
+    if (strncmp(name, "SIG", 3) == 0) {
+        name += 3;
+    }
+    for (size_t i = 0; i < sizeof(signal_names) / sizeof(signal_names[0]); i++) {
+        if (strcmp(signal_names[i].name, name) == 0) {
+            return signal_names[i].sig;
+        }
+    }
+    return -1;
+}
+
+// O usuário assume o controle de um grupo suspenso pela proteção de memória
+void release_memguard(ProcessGroup *group) {
+    if (group->paused_seq != 0) {
+        group->paused_seq = 0;
+        memguard.paused--;
+    }
+}
+
+// Passa o terminal para o grupo. SIGTTOU fica bloqueado para que a shell,
+// já fora do grupo do terminal, possa pegá-lo de volta.
+void terminal_handoff(pid_t pgid) {
+    if (pgid <= 0 || !isatty(STDIN_FILENO)) {
+        return;
+    }
+    sigset_t set, old;
+    sigemptyset(&set);
+    sigaddset(&set, SIGTTOU);
+    sigprocmask(SIG_BLOCK, &set, &old);
+    tcsetpgrp(STDIN_FILENO, pgid);
+    sigprocmask(SIG_SETMASK, &old, NULL);
+}
+
+// Espera o grupo em foreground terminar ou ser suspenso (Ctrl-Z no terminal
+// do grupo ou SIGTSTP na shell). Retorna 1 se foi suspenso.
+int wait_group_foreground(ProcessGroup *group) {
+    fg_stop_requested = 0;
+    while (1) {
+        int live = 0, stopped = 0;
+        for (int j = 0; j < group->count; j++) {
+            pid_t pid = group->pids[j];
+            if (pid == 0) {
+                continue;
+            }
+            int status;
+            struct rusage ru;
+            pid_t result = wait4(pid, &status, WNOHANG | WUNTRACED, &ru);
+            if (result == pid && WIFSTOPPED(status)) {
+                stopped = 1;
+                live++;
+            } else if (result == pid) {
+                mark_background_finished(pid, status, &ru);
+            } else if (result == 0) {
+                live++;
+            } else {
+                array_task_finished(group, pid, W_EXITCODE(255, 0));
+                group->pids[j] = 0; // Não é mais nosso filho
+                supervise_exited(group, pid, W_EXITCODE(255, 0));
+            }
+        }
+        if (group->array != 0) {
+            run_arrays(); // O array continua lançando tarefas enquanto é esperado
+            live += group->array != 0;
+        }
+        if (live == 0) {
+            return 0;
+        }
+        if (stopped || fg_stop_requested) {
+            return 1;
+        }
+        struct pollfd pfds[1 + MAX_OUTPUT_STREAMS] = { { .fd = wheel.fd, .events = POLLIN } };
+        int nfds = 1 + output_poll_fds(pfds + 1);
+        if (poll(pfds, nfds, JOB_WAIT_POLL_MS) > 0) {
+            if (pfds[0].revents & POLLIN) {
+                wheel_run();
+            }
+            if (nfds > 1) {
+                output_pump(pfds + 1, 0);
+            }
+        }
+    }
+}
+
+void foreground_job(ProcessGroup *group) {
+    release_memguard(group);
+    reclassify_job(group, &fg_sched_class);
+    for (int j = 0; j < group->count; j++) {
+        if (group->pids[j] != 0) {
+            printf("%s\n", group->names[j]);
+        }
+    }
+    fflush(stdout);
+    terminal_handoff(group->pgid);
+    propagate_signal_to_group(group, SIGCONT);
+    group->stopped = 0;
+    group->gang_paused = 0;
+    int id = group->id;
+    gang.exempt_id = id;
+    int stopped = wait_group_foreground(group);
+    gang.exempt_id = 0;
+    terminal_handoff(getpgrp());
+    if (stopped) {
+        group = find_bg_group(id);
+        if (group != NULL) {
+            group->stopped = 1;
+            reclassify_job(group, &bg_sched_class);
+            printf("\n[%d] Parado\n", id);
+        }
+    }
+}
+
+// kill [-SINAL] %job, stop %job, cont %job, fg [%job], bg [%job]
+void job_command(char *command) {
+    char *save;
+    char *name = strtok_r(command, " ", &save);
+    char *arg = strtok_r(NULL, " ", &save);
+    int sig = SIGTERM;
+    if (strcmp(name, "kill") == 0 && arg != NULL && arg[0] == '-') {
+        sig = parse_signal(arg + 1);
+        if (sig < 0) {
+            printf("Sinal desconhecido: %s\n", arg + 1);
+            return;
+        }
+        arg = strtok_r(NULL, " ", &save);
+    }
+    if (arg == NULL && (strcmp(name, "fg") == 0 || strcmp(name, "bg") == 0)) {
+        arg = "%%";
+    }
+    ProcessGroup *group = find_job(arg);
+    if (group == NULL) {
+        printf("Uso: %s %s%%job (job %s não encontrado)\n", name, strcmp(name, "kill") == 0 ? "[-SINAL] " : "",
+               arg ? arg : "");
+        return;
+    }
+
+    if (strcmp(name, "fg") == 0) {
+        if (group->array != 0) {
+            printf("[%d] é um array de jobs e não vai para o foreground; use wait %%%d\n", group->id, group->id);
+            return;
+        }
+        foreground_job(group);
+        return;
+    }
+    if (strcmp(name, "stop") == 0) {
+        sig = SIGSTOP;
+    } else if (strcmp(name, "cont") == 0 || strcmp(name, "bg") == 0) {
+        sig = SIGCONT;
+    }
+    if (group->array != 0 && sig != SIGSTOP && sig != SIGTSTP && sig != SIGCONT) {
+        job_arrays[group->array - 1].cancelled = 1; // As tarefas ainda não lançadas não rodam mais
+    }
+    if (sig != SIGSTOP && sig != SIGTSTP && sig != SIGCONT) {
+        supervise_cancel_group(group); // Quem mata o job não quer que ele volte
+    }
+    release_memguard(group);
+    if (strcmp(name, "bg") == 0) {
+        reclassify_job(group, &bg_sched_class);
+    }
+    if (sig == SIGCONT && group->pgid > 0) {
+        killpg(group->pgid, SIGCONT); // Cobre também o caso de um processo parado pelo próprio terminal
+        group->stopped = 0;
+    } else {
+        propagate_signal_to_group(group, sig);
+        if (sig == SIGSTOP || sig == SIGTSTP) {
+            group->stopped = 1;
+        } else if (sig == SIGCONT) {
+            group->stopped = 0;
+        }
+    }
+    if (group->gang_paused && sig != SIGSTOP && sig != SIGTSTP) {
+        if (sig != SIGCONT) {
+            propagate_signal_to_group(group, SIGCONT); // Parado, o grupo só veria o sinal na volta ao rodízio
+        }
+        group->gang_paused = 0; // O rodízio o tira de novo se faltar vaga
+    }
+    printf("[%d] SIG%s (%d) enviado ao grupo %d\n", group->id, signal_name(sig), sig,
+           group->pgid ? group->pgid : group->pids[0]);
+}
+
+// Um job em foreground suspenso vai para a tabela de background, parado,
+// para ser retomado depois com fg ou bg
+void adopt_stopped_foreground(pid_t pid, const char *command, int64_t started_ns) {
+    if (num_bg_process_groups >= MAX_PROCESSES) {
+        printf("\nNúmero máximo de grupos em background atingido, job (PID=%d) continua parado\n", pid);
+        return;
+    }
+    ProcessGroup *group = &bg_process_groups[num_bg_process_groups++];
+    memset(group, 0, sizeof(*group));
+    group->id = next_group_id++;
+    group->deadline_timer = -1;
+#if FSH_SIGNALS == FSH_SIGNALS_GROUP
+    group->pgid = pid;
+#endif
+    track_process(group, pid, command);
+    group->started_ns[0] = started_ns;
+    group->stopped = 1;
+    group->active_ns = mono_ns();
+    printf("\n[%d] Parado  %s\n", group->id, command);
+}
+
+// Builtins que esperam por jobs sem travar o prompt ("waitall &", "wait %job
+// &"). Cada um vira uma tarefa do loop principal: guarda os grupos que
+// existiam quando foi pedido e, a cada volta do loop, descarta os que já
+// terminaram. Quem reapa continua sendo o reaper; a tarefa só observa, e
+// grupos criados depois não entram na espera.
+int group_is_pending(int id) {
+    return find_bg_group(id) != NULL || queued_count(id) > 0;
+}
+
+WaitTask *task_create(const char *desc) {
+    for (int i = 0; i < MAX_TASKS; i++) {
+        if (!wait_tasks[i].active) {
+            WaitTask *task = &wait_tasks[i];
+            memset(task, 0, sizeof(*task));
+            task->active = 1;
+            task->id = next_task_id++;
+            task->started_ns = mono_ns();
+            snprintf(task->desc, sizeof(task->desc), "%s", desc);
+            return task;
+        }
+    }
+    printf("Número máximo de tarefas atingido\n");
+    return NULL;
+}
+
+void task_add_group(WaitTask *task, int id) {
+    if (task->num_ids < MAX_PROCESSES + MAX_QUEUED_JOBS) {
+        task->ids[task->num_ids++] = id;
+    }
+}
+
+// Chamado quando um grupo sai da tabela, com o total de falhas dele
+void tasks_group_done(ProcessGroup *group) {
+    for (int i = 0; i < MAX_TASKS; i++) {
+        WaitTask *task = &wait_tasks[i];
+        for (int k = 0; task->active && k < task->num_ids; k++) {
+            if (task->ids[k] == group->id) {
+                task->finished += group->reaped;
+                task->failed += group->failed;
+            }
+        }
+    }
+}
+
+void tasks_run() {
+    dag_step();
+    for (int i = 0; i < MAX_TASKS; i++) {
+        WaitTask *task = &wait_tasks[i];
+        if (!task->active) {
+            continue;
+        }
+        int k = 0;
+        for (int j = 0; j < task->num_ids; j++) {
+            if (group_is_pending(task->ids[j])) {
+                task->ids[k++] = task->ids[j];
+            }
+        }
+        task->num_ids = k;
+        if (task->num_ids == 0) {
+            notify_text("[tarefa %d] %s concluído em %.1fs: %d processos, %d falharam\n", task->id, task->desc,
+                        (mono_ns() - task->started_ns) / 1e9, task->finished, task->failed);
+            task->active = 0;
+        }
+    }
+}
+
+void tasks_command() {
+    int any = 0;
+    for (int i = 0; i < MAX_TASKS; i++) {
+        WaitTask *task = &wait_tasks[i];
+        if (task->active) {
+            printf("[tarefa %d] %s: %d grupos pendentes, %.1fs\n", task->id, task->desc, task->num_ids,
+                   (mono_ns() - task->started_ns) / 1e9);
+            any = 1;
+        }
+    }
+    if (!any) {
+        printf("Nenhuma tarefa em andamento\n");
+    }
+}
+
+// Tarefa que espera todos os grupos atuais, inclusive os comandos ainda na fila
+WaitTask *task_wait_all(const char *desc) {
+    WaitTask *task = task_create(desc);
+    if (task == NULL) {
+        return NULL;
+    }
+    for (int i = 0; i < num_bg_process_groups; i++) {
+        task_add_group(task, bg_process_groups[i].id);
+    }
+    for (int i = 0; i < queued_ids_cap; i++) {
+        if (queued_ids[i] != 0 && find_bg_group(queued_ids[i]) == NULL) {
+            task_add_group(task, queued_ids[i]);
+        }
+    }
+    return task;
+}
+
+// waitall &
+void waitall_async() {
+    WaitTask *task = task_wait_all("waitall");
+    if (task != NULL) {
+        printf("[tarefa %d] aguardando %d grupos em segundo plano\n", task->id, task->num_ids);
+    }
+}
+
+// wait %job [&]
+void wait_command(char *args) {
+    char *save;
+    char *spec = strtok_r(args, " ", &save);
+    char *amp = strtok_r(NULL, " ", &save);
+    ProcessGroup *group = find_job(spec);
+    if (group == NULL || (amp != NULL && strcmp(amp, "&") != 0)) {
+        printf("Uso: wait %%job [&]\n");
+        return;
+    }
+    if (amp == NULL) {
+        int id = group->id;
+        if (wait_group_foreground(group)) {
+            printf("\n[%d] Parado\n", id);
+        }
+        return;
+    }
+    char desc[64];
+    snprintf(desc, sizeof(desc), "wait %%%d", group->id);
+    WaitTask *task = task_create(desc);
+    if (task != NULL) {
+        task_add_group(task, group->id);
+        printf("[tarefa %d] aguardando o grupo [%d] em segundo plano\n", task->id, group->id);
+    }
+}
+
+// waitall: reapa com WNOHANG e dorme em ppoll sobre a roda de timers e os
+// pipes de saída, para que prazos, admissão e proteção de memória sigam
+// funcionando enquanto a shell espera. SIGCHLD fica bloqueado entre o teste
+// de child_exited e o ppoll, como no modo -c.
+void waitall_command() {
+    while (1) {
+        int status;
+        struct rusage ru;
+        pid_t pid;
+        while ((pid = wait4(-1, &status, WNOHANG, &ru)) > 0) {
+            mark_background_finished(pid, status, &ru); // Manter a tabela de grupos em dia
+        }
+        if (pid < 0 && errno == EINTR) {
+            continue;
+        }
+        compact_bg_groups(); // Grupos que terminaram liberam os jobs do DAG que dependem deles
+        drain_admission_queue();
+        memguard_check();
+        gang_check(); // Vagas do rodízio são preenchidas durante a espera
+        run_arrays(); // Arrays seguem lançando tarefas durante a espera
+        dag_step(); // E o DAG, os jobs liberados pelas dependências
+        int queued = admission_len > 0 || arrays_waiting();
+#if FSH_WAITALL == FSH_WAITALL_NOHANG
+        (void)queued;
+        break; // Só coletar quem já terminou
+#else
+        if (pid < 0 && errno == ECHILD && !queued && !dag_run.active) {
+            break; // Nenhum filho e nada por lançar
+        }
+        struct pollfd pfds[1 + MAX_OUTPUT_STREAMS] = { { .fd = wheel.fd, .events = POLLIN } };
+        int nfds = 1 + output_poll_fds(pfds + 1);
+        struct timespec tick = { 0, ADMISSION_POLL_MS * 1000000L };
+        sigset_t chld, orig;
+        sigemptyset(&chld);
+        sigaddset(&chld, SIGCHLD);
+        sigprocmask(SIG_BLOCK, &chld, &orig);
+        int ready = child_exited ? 0 : ppoll(pfds, nfds, queued ? &tick : NULL, &orig);
+        child_exited = 0;
+        sigprocmask(SIG_SETMASK, &orig, NULL);
+        if (ready > 0 && (pfds[0].revents & POLLIN)) {
+            wheel_run();
+        }
+        if (ready > 0 && nfds > 1) {
+            output_pump(pfds + 1, 0);
+        }
+#endif
+    }
+}
+
+int execute_command(char *command) {
+    // Remover espaços extras do comando
+    while (*command == ' ') command++;
+    char *end = command + strlen(command) - 1;
+    while (end > command && *end == ' ') end--;
+    *(end + 1) = '\0';
+    last_status = 0; // Comandos internos terminam com sucesso
+
+    if (strcmp(command, "die") == 0) {
+        notify_flush();
+        printf("Comando 'die' recebido. Finalizando todos os processos...\n");
+        terminate_all_processes();
+        exit(0);
+        return 1; // Comando interno
+
+    } else if (strcmp(command, "dag") == 0 || strcmp(command, "dag cont") == 0) {
+        dag_status(command[3] != '\0');
+        return 1; // Comando interno
+
+    } else if (strncmp(command, "dag ", 4) == 0) {
+        // dag [-j N] arquivo
+        int max_parallel = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        char *path = NULL;
+        char *save;
+        for (char *arg = strtok_r(command + 4, " ", &save); arg; arg = strtok_r(NULL, " ", &save)) {
+            if (strcmp(arg, "-j") == 0) {
+                char *n = strtok_r(NULL, " ", &save);
+                max_parallel = n ? atoi(n) : 0;
+            } else {
+                path = arg;
+            }
+        }
+        if (path == NULL || max_parallel < 1) {
+            printf("Uso: dag [-j N] arquivo | dag [cont]\n");
+            return 1;
+        }
+        dag_start(path, max_parallel);
+        return 1; // Comando interno
+
+    } else if (strcmp(command, "history-jobs") == 0 || strncmp(command, "history-jobs ", 13) == 0) {
+        history_jobs(command + 12);
+        return 1; // Comando interno
+
+    } else if (strcmp(command, "waitall &") == 0 || strcmp(command, "waitall&") == 0) {
+        waitall_async();
+        return 1; // Comando interno
+
+    } else if (strncmp(command, "wait ", 5) == 0) {
+        wait_command(command + 5);
+        return 1; // Comando interno
+
+    } else if (strcmp(command, "workers") == 0 || strncmp(command, "workers ", 8) == 0) {
+        workers_command(command + 7);
+        return 1; // Comando interno
+
+    } else if (strncmp(command, "remote ", 7) == 0) {
+        remote_dispatch(command + 7, next_remote_id++);
+        return 1; // Comando interno
+
+    } else if (strcmp(command, "array") == 0 || strncmp(command, "array ", 6) == 0) {
+        array_command(command + 5);
+        return 1; // Comando interno
+
+    } else if (strcmp(command, "supervise") == 0 || strncmp(command, "supervise ", 10) == 0) {
+        supervise_command(command + 9);
+        return 1; // Comando interno
+
+    } else if (strcmp(command, "tasks") == 0) {
+        tasks_command();
+        return 1; // Comando interno
+
+    } else if (strcmp(command, "waitall") == 0) {
+        printf("Aguardando todos os processos filhos...\n");
+        waitall_command();
+        return 1; // Comando interno
+
+    } else if (strcmp(command, "admission") == 0 || strncmp(command, "admission ", 10) == 0) {
+        admission_command(command + 9);
+        return 1; // Comando interno
+
+    } else if (strcmp(command, "placement") == 0 || strncmp(command, "placement ", 10) == 0) {
+        placement_command(command + 9);
+        return 1; // Comando interno
+
+    } else if (strcmp(command, "jobs") == 0 || strncmp(command, "jobs ", 5) == 0) {
+        jobs_command(command + 4);
+        return 1; // Comando interno
+
+    } else if (strcmp(command, "sched") == 0 || strncmp(command, "sched ", 6) == 0) {
+        sched_command(command + 5);
+        return 1; // Comando interno
+
+    } else if (strcmp(command, "timeout") == 0 || strncmp(command, "timeout ", 8) == 0) {
+        timeout_command(command + 7);
+        return 1; // Comando interno
+
+    } else if (strcmp(command, "queue") == 0 || strncmp(command, "queue ", 6) == 0) {
+        queue_command(command + 5);
+        return 1; // Comando interno
+
+    } else if (strcmp(command, "gang") == 0 || strncmp(command, "gang ", 5) == 0) {
+        gang_command(command + 4);
+        return 1; // Comando interno
+
+    } else if (strcmp(command, "memguard") == 0 || strncmp(command, "memguard ", 9) == 0) {
+        memguard_command(command + 8);
+        return 1; // Comando interno
+
+    } else if (strcmp(command, "output") == 0 || strncmp(command, "output ", 7) == 0) {
+        output_command(command + 6);
+        return 1; // Comando interno
+
+    } else if (strcmp(command, "board") == 0 || strncmp(command, "board ", 6) == 0) {
+        board_command(command + 5);
+        return 1; // Comando interno
+
+    } else if (strcmp(command, "record") == 0 || strncmp(command, "record ", 7) == 0) {
+        record_command(command + 6);
+        return 1; // Comando interno
+
+    } else if (strcmp(command, "profile") == 0 || strncmp(command, "profile ", 8) == 0) {
+        profile_command(command + 7);
+        return 1; // Comando interno
+
+    } else if (strcmp(command, "events") == 0 || strncmp(command, "events ", 7) == 0) {
+        events_command(command + 6);
+        return 1; // Comando interno
+
+    } else if ((strncmp(command, "kill ", 5) == 0 || strncmp(command, "stop ", 5) == 0 ||
+                strncmp(command, "cont ", 5) == 0 || strncmp(command, "fg ", 3) == 0 ||
+                strncmp(command, "bg ", 3) == 0) && strchr(command, '%') != NULL) {
+        job_command(command); // Sem %job, kill segue como comando externo
+        return 1; // Comando interno
+
+    } else if (strcmp(command, "fg") == 0 || strcmp(command, "bg") == 0) {
+        job_command(command);
+        return 1; // Comando interno
+
+    } else if (strcmp(command, "metrics") == 0) {
+        render_metrics(stdout);
+        return 1; // Comando interno
+
+    } else { // Executa comando em foreground
+        JobOptions opts;
+        command = parse_job_options(command, &opts);
+        char **envp = build_job_env(&opts);
+        int probe[2];
+        uint64_t counters[PROF_COUNTERS];
+        exec_probe_open(probe);
+        profile_before_fork(counters);
+        int64_t fork_ns = mono_ns();
+        pid_t pid = fork();
+
+        if (pid < 0) {
+            perror("Erro no fork");
+            metrics_spawn_failed();
+            exec_probe_close(probe);
+            profile_after_fork(pid, counters);
+            last_status = 1;
+            return 0;
+        }
+
+        if (pid == 0) { // Processo filho (foreground)
+            profile_child_wait();
+            exec_probe_child(probe);
+            join_process_group(0); // Definir novo grupo de processos
+            signal(SIGINT, SIG_IGN); // Ignorar SIGINT
+            if (fg_sched_class.policy != SCHED_OTHER || fg_sched_class.nice != 0 ||
+                fg_sched_class.io_class != IOPRIO_CLASS_NONE) {
+                apply_sched_class(&fg_sched_class); // Só se o usuário mudou a classe padrão
+            }
+            launcher_exec(command, envp);
+            int err = errno;
+            perror("Erro ao executar comando em foreground");
+            exit(err == ENOENT ? 127 : 126); // Como o sh: não encontrado ou não executável
+        } else { // Processo pai
+            int64_t started_ns = now_ns();
+            int status;
+            struct rusage ru;
+            fg_process_pid = pid;
+            session_event(SESSION_JOB_START, 0, pid, 0, NULL, 0);
+            profile_after_fork(pid, counters);
+            exec_probe_wait(probe, fork_ns);
+            profile_exec_done(pid);
+            metrics_spawned(1);
+            if (opts.timeout_ms > 0) {
+                fg_timer = timer_add(opts.timeout_ms, -1, pid, 0);
+            }
+            int stopped = wait_foreground(pid);
+            timer_cancel(fg_timer);
+            fg_timer = -1;
+            if (stopped) {
+                fg_process_pid = 0;
+                last_status = 128 + SIGTSTP;
+                adopt_stopped_foreground(pid, command, started_ns);
+                return 0;
+            }
+            profile_self_begin(counters);
+            pid_t reaped = wait4(pid, &status, 0, &ru);
+            profile_self_end(PROF_REAP, counters);
+            if (reaped == pid) {
+                last_status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+                log_finished_job(pid, job_pgid(pid), hash_command(command), command, started_ns, status, &ru);
+                metrics_reaped();
+                metrics_reap_pass_done();
+            }
+            fg_process_pid = 0;
+        }
+        return 0; // Não é comando interno
+    }
+}
+
+// Copia o comando trocando $? pelo último status; entre aspas simples não há troca
+void expand_status(const char *src, char *dst, size_t size) {
+    size_t len = 0;
+    char quote = 0;
+    for (; *src != '\0' && len + 12 < size; src++) {
+        if (*src == '\'' && quote != '"') {
+            quote = quote ? 0 : '\'';
+        } else if (*src == '"' && quote != '\'') {
+            quote = quote ? 0 : '"';
+        } else if (*src == '$' && src[1] == '?' && quote != '\'') {
+            len += snprintf(dst + len, size - len, "%d", last_status);
+            src++;
+            continue;
+        }
+        dst[len++] = *src;
+    }
+    dst[len] = '\0';
+}
+
+// A linha usa sintaxe composta do sh (palavras reservadas, subshell, grupo
+// ou substituição de comando)? Essas linhas não são divididas pela shell:
+// vão inteiras para /bin/sh -c. Aspas e escapes protegem, como em run_chain.
+int is_compound_line(const char *line) {
+    static const char *keywords[] = { "if", "then", "else", "elif", "fi", "for", "while", "until", "do",
+                                      "done", "case", "esac", "select", "function", "!", NULL };
+    char quote = 0;
+    for (const char *p = line; *p != '\0'; p++) {
+        if (quote) {
+            if (*p == quote) quote = 0;
+            else if (*p == '\\' && quote == '"' && p[1] != '\0') p++;
+            else if (*p == '`' || (*p == '$' && p[1] == '(')) return quote == '"';
+        } else if (*p == '\\' && p[1] != '\0') {
+            p++;
+        } else if (*p == '\'' || *p == '"') {
+            quote = *p;
+        } else if (strchr("(){}`", *p) != NULL) {
+            return 1;
+        } else if (p == line || strchr(" \t;&|", p[-1]) != NULL) {
+            size_t n = strcspn(p, " \t;&|");
+            for (int k = 0; keywords[k] != NULL; k++) {
+                if (strlen(keywords[k]) == n && strncmp(p, keywords[k], n) == 0) {
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+// Executa uma cadeia "a && b || c ; d" sem passar por /bin/sh, um fork por
+// comando de fato executado. Como no sh, os três operadores têm a mesma
+// precedência e são avaliados da esquerda para a direita, e um comando pulado
+// não muda o $?. Operadores entre aspas ou escapados são do comando. Retorna
+// 1 se todos os comandos executados eram internos.
+int run_chain(char *line) {
+    if (is_compound_line(line)) {
+        return execute_command(line); // O $? dentro da linha é o do próprio sh
+    }
+    int internal = 1, executed = 0;
+    char op = ';'; // Operador antes do comando atual
+    char *p = line;
+    while (*p != '\0') {
+        char *start = p;
+        char next = ';', quote = 0;
+        for (; *p != '\0'; p++) {
+            if (quote) {
+                if (*p == quote) quote = 0;
+                else if (*p == '\\' && quote == '"' && p[1] != '\0') p++;
+            } else if (*p == '\\' && p[1] != '\0') {
+                p++;
+            } else if (*p == '\'' || *p == '"') {
+                quote = *p;
+            } else if (*p == ';') {
+                *p++ = '\0';
+                break;
+            } else if ((*p == '&' || *p == '|') && p[1] == *p) {
+                next = *p;
+                *p = '\0';
+                p += 2;
+                break;
+            }
+        }
+        int run = op == ';' || (op == '&' && last_status == 0) || (op == '|' && last_status != 0);
+        if (run && start[strspn(start, " \t")] != '\0') {
+            char command[MAX_BUFFER];
+            expand_status(start, command, sizeof(command));
+            internal &= execute_command(command);
+            executed++;
+        }
+        op = next;
+    }
+    return executed > 0 && internal;
+}
+
+// Compactar a lista de grupos de processos em background
+void compact_bg_groups() {
+    int k = 0;
+    for (int i = 0; i < num_bg_process_groups; i++) {
+        // Array com tarefas por lançar e job supervisionado esperando reinício ficam
+        if (group_live(&bg_process_groups[i]) > 0 || bg_process_groups[i].array != 0 ||
+            bg_process_groups[i].supervised > 0) {
+            bg_process_groups[k++] = bg_process_groups[i];
+        } else {
+            timer_cancel(bg_process_groups[i].deadline_timer);
+            tasks_group_done(&bg_process_groups[i]);
+            dag_group_done(&bg_process_groups[i]);
+            worker_group_done(&bg_process_groups[i]);
+            board_group_done(&bg_process_groups[i]);
+            if (bg_process_groups[i].paused_seq != 0) {
+                memguard.paused--;
+            }
+        }
+    }
+    num_bg_process_groups = k; // Atualizar o contador de grupos de processos em background
+}
+
+#if FSH_REAPER == FSH_REAP_ANY
+// Reaper por waitpid(-1): uma chamada por filho terminado, sem percorrer a tabela
+void reap_background_processes() {
+    int status;
+    struct rusage ru;
+    pid_t pid;
+    uint64_t counters[PROF_COUNTERS];
+    uint64_t reaps = atomic_load_explicit(&metrics->reaps, memory_order_relaxed);
+    profile_self_begin(counters);
+    while ((pid = wait4(-1, &status, WNOHANG, &ru)) > 0) {
+        mark_background_finished(pid, status, &ru);
+    }
+    if (atomic_load_explicit(&metrics->reaps, memory_order_relaxed) != reaps) {
+        profile_self_end(PROF_REAP, counters); // Passadas vazias não contam
+    }
+    fflush(stdout);
+    metrics_reap_pass_done();
+    compact_bg_groups();
+}
+#else
+// Verificar a conclusão dos processos em background
+void reap_background_processes() {
+    int status;
+    uint64_t counters[PROF_COUNTERS];
+    uint64_t reaps = atomic_load_explicit(&metrics->reaps, memory_order_relaxed);
+    profile_self_begin(counters);
+    for (int i = 0; i < num_bg_process_groups; i++) {
+        for (int j = 0; j < bg_process_groups[i].count; j++) {
+            if (bg_process_groups[i].pids[j] != 0) {
+                struct rusage ru;
+                pid_t result = wait4(bg_process_groups[i].pids[j], &status, WNOHANG, &ru);
+                if (result == 0) {
+                    //Processo ainda está em execução
+                    continue;
+                } else if (result == -1) {
+                    perror("Erro ao esperar pelo processo em background");
+                    array_task_finished(&bg_process_groups[i], bg_process_groups[i].pids[j], W_EXITCODE(255, 0));
+                    timer_cancel(bg_process_groups[i].timers[j]);
+                    supervise_exited(&bg_process_groups[i], bg_process_groups[i].pids[j], W_EXITCODE(255, 0));
+                    bg_process_groups[i].pids[j] = 0; // Não é mais nosso filho
+                } else {
+                    //Processo terminou
+                    notify_finished(bg_process_groups[i].id, result, status);
+                    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                        bg_process_groups[i].failed++;
+                        bg_process_groups[i].exit_status = status;
+                    }
+                    bg_process_groups[i].reaped++;
+                    bg_process_groups[i].cpu_ns += rusage_cpu_ns(&ru);
+                    array_task_finished(&bg_process_groups[i], result, status);
+                    log_finished_job(result, bg_process_groups[i].pgid, bg_process_groups[i].hashes[j],
+                                     bg_process_groups[i].names[j], bg_process_groups[i].started_ns[j], status, &ru);
+                    metrics_reaped();
+                    timer_cancel(bg_process_groups[i].timers[j]);
+                    bg_process_groups[i].pids[j] = 0; // Resetar o PID após a conclusão
+                    supervise_exited(&bg_process_groups[i], result, status);
+                }
+            }
+        }
+    }
+
+
+    // Órfãos adotados pela shell (Px' e processos que os jobs deixaram para
+    // trás) não estão na tabela; sem esta passada virariam zumbis
+    struct rusage ru;
+    pid_t pid;
+    while ((pid = wait4(-1, &status, WNOHANG, &ru)) > 0) {
+        mark_background_finished(pid, status, &ru);
+    }
+    if (atomic_load_explicit(&metrics->reaps, memory_order_relaxed) != reaps) {
+        profile_self_end(PROF_REAP, counters); // Passadas vazias não contam
+    }
+
+    metrics_reap_pass_done();
+    compact_bg_groups();
+}
+#endif
+
+// Entrada lida de stdin com read(), acumulada até formar uma linha. Não usamos
+// fgets porque o buffer do stdio esconderia linhas já lidas do poll().
+char input_buf[MAX_BUFFER];
+size_t input_len = 0;
+int input_eof = 0;
+
+// Copia a próxima linha completa para 'line'; retorna 0 se ainda não há uma
+int next_input_line(char *line) {
+    char *nl = memchr(input_buf, '\n', input_len);
+    size_t n;
+    if (nl != NULL) {
+        n = nl - input_buf + 1;
+    } else if (input_len == sizeof(input_buf) - 1 || (input_eof && input_len > 0)) {
+        n = input_len; // Linha longa demais ou última linha sem '\n'
+    } else {
+        return 0;
+    }
+    memcpy(line, input_buf, n);
+    line[n] = '\0';
+    memmove(input_buf, input_buf + n, input_len - n);
+    input_len -= n;
+    return 1;
+}
+
+void fill_input() {
+    ssize_t n = read(STDIN_FILENO, input_buf + input_len, sizeof(input_buf) - 1 - input_len);
+    if (n > 0) {
+        input_len += n;
+    } else if (n == 0) {
+        input_eof = 1;
+    } else if (errno != EINTR) {
+        perror("Erro ao ler o comando");
+    }
+}
+
+// Uma linha: a cadeia em foreground e os comandos em background depois de cada #
+void run_line(char *buffer) {
+    buffer[strcspn(buffer, "\n")] = '\0';
+
+    char *commands[MAX_COMMANDS] = { NULL };
+    char *token = strtok(buffer, "#");
+    int cmd_count = 0;
+
+    while (token && cmd_count < MAX_COMMANDS) {
+        commands[cmd_count++] = token;
+        token = strtok(NULL, "#");
+    }
+
+    if (cmd_count > 0) {
+        int is_internal = run_chain(commands[0]);
+
+        if (!is_internal && cmd_count > 1 && num_bg_process_groups >= MAX_PROCESSES) {
+            printf("Número máximo de grupos em background atingido\n");
+        } else if (!is_internal) {
+            ProcessGroup group = { .count = 0, .id = next_group_id++, .deadline_timer = -1 };
+            for (int i = 1; i < cmd_count; i++) {
+                char command[MAX_BUFFER];
+                expand_status(commands[i], command, sizeof(command));
+                execute_background(command, &group);
+            }
+            if (group.count > 0) {
+                start_group_deadline(&group);
+                bg_process_groups[num_bg_process_groups++] = group;
+            }
+        }
+    }
+}
+
+// Interrompido no modo -c: os jobs vão junto, como no die. Só kill, que pode
+// ser chamado de um tratador de sinal.
+void handle_oneshot_signal(int sig) {
+    if (fg_process_pid != 0) {
+        signal_job(fg_process_pid, SIGKILL);
+    }
+    for (int i = 0; i < num_bg_process_groups; i++) {
+        if (bg_process_groups[i].pgid > 0) {
+            kill(-bg_process_groups[i].pgid, SIGKILL);
+        }
+        for (int j = 0; j < bg_process_groups[i].count; j++) {
+            if (bg_process_groups[i].pids[j] != 0) {
+                kill(bg_process_groups[i].pids[j], SIGKILL);
+            }
+        }
+    }
+    _exit(128 + sig);
+}
+
+// fsh [-n] -c 'cmd # bg1 # bg2': executa uma linha e sai, sem prompt, sem
+// leitura do stdin e sem o que só serve à sessão interativa (métricas
+// compartilhadas, exportador, gravação). Por padrão espera os comandos em
+// background, inclusive os processos adotados (Px'); com -n sai logo depois
+// do foreground e os deixa rodando. O status de saída é o da cadeia em
+// foreground se ela falhou, senão 1 se algum processo em background falhou,
+// senão 0.
+int oneshot_main(int argc, char *argv[]) {
+    int wait_background = 1;
+    char *line = NULL;
+    int opt, bad = 0;
+    while ((opt = getopt(argc, argv, "nc:")) != -1) {
+        switch (opt) {
+        case 'n': wait_background = 0; break;
+        case 'c': line = optarg; break;
+        default: bad = 1; break;
+        }
+    }
+    if (line == NULL || bad) {
+        fprintf(stderr, "Uso: %s [-n] -c 'comando # bg1 # bg2'\n", argv[0]);
+        return 2;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_oneshot_signal;
+    sigfillset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sa.sa_handler = handle_sigchld;
+    sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    sigaction(SIGCHLD, &sa, NULL);
+    notifier.quiet = 1; // Quem chama quer a saída dos comandos, não os avisos da shell
+    job_log_open();
+    if (wait_background && prctl(PR_SET_CHILD_SUBREAPER, 1) < 0) {
+        perror("Erro ao tornar a shell subreaper");
+    }
+
+    char buffer[MAX_BUFFER];
+    snprintf(buffer, sizeof(buffer), "%s", line);
+    run_line(buffer);
+    int status = last_status;
+    if (!wait_background && !dag_run.active) {
+        fflush(stdout);
+        _exit(status);
+    }
+
+    // SIGCHLD fica bloqueado entre o teste de child_exited e o ppoll, que o
+    // desbloqueia atomicamente: um filho que termina entre o reap e o ppoll
+    // não deixa a espera parada até o próximo timeout. O DAG é o comando em
+    // foreground, então mesmo com -n a shell espera por ele.
+    WaitTask *task = wait_background ? task_wait_all("fsh -c") : NULL;
+    sigset_t chld, orig;
+    sigemptyset(&chld);
+    sigaddset(&chld, SIGCHLD);
+    while ((task != NULL && task->active) || dag_run.active) {
+        reap_background_processes();
+        drain_admission_queue();
+        gang_check();
+        run_arrays();
+        tasks_run();
+        if ((task == NULL || !task->active) && !dag_run.active) {
+            break;
+        }
+        struct pollfd pfds[1 + MAX_OUTPUT_STREAMS] = { { .fd = wheel.fd, .events = POLLIN } };
+        int nfds = 1 + output_poll_fds(pfds + 1);
+        struct timespec tick = { 0, ADMISSION_POLL_MS * 1000000L };
+        int queued = admission_len > 0 || arrays_waiting();
+        sigprocmask(SIG_BLOCK, &chld, &orig);
+        int ready = child_exited ? 0 : ppoll(pfds, nfds, queued ? &tick : NULL, &orig);
+        child_exited = 0;
+        sigprocmask(SIG_SETMASK, &orig, NULL);
+        if (ready > 0 && (pfds[0].revents & POLLIN)) {
+            wheel_run();
+        }
+        if (ready > 0 && nfds > 1) {
+            output_pump(pfds + 1, 0);
+        }
+    }
+    output_pump(NULL, 0);
+    // Os adotados (Px' e o que os jobs deixaram para trás) fazem parte dos jobs
+    while (wait_background && (wait4(-1, NULL, 0, NULL) > 0 || errno == EINTR)) {
+    }
+    fflush(stdout);
+    if (status == 0 && ((task != NULL && task->failed > 0) || dag_run.failed > 0)) {
+        status = 1;
+    }
+    return status;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1) {
+        return oneshot_main(argc, argv);
+    }
+
+    struct sigaction sa_int, sa_tstp;
+    memset(&sa_int, 0, sizeof(sa_int));
+    sa_int.sa_handler = handle_sigint;
+    sa_int.sa_flags = SA_RESTART; // Reiniciar chamadas de sistema interrompidas
+    sigfillset(&sa_int.sa_mask);
+    sigaction(SIGINT, &sa_int, NULL);
+
+    memset(&sa_tstp, 0, sizeof(sa_tstp));
+    sa_tstp.sa_handler = handle_sigtstp;
+    sa_tstp.sa_flags = SA_RESTART; // Reiniciar chamadas de sistema interrompidas
+    sigfillset(&sa_tstp.sa_mask);
+    sigaction(SIGTSTP, &sa_tstp, NULL);
+
+    metrics_init();
+
+    struct sigaction sa_chld;
+    memset(&sa_chld, 0, sizeof(sa_chld));
+    sa_chld.sa_handler = handle_sigchld;
+    sa_chld.sa_flags = SA_RESTART | SA_NOCLDSTOP; // Reiniciar chamadas de sistema interrompidas
+    sigfillset(&sa_chld.sa_mask);
+    sigaction(SIGCHLD, &sa_chld, NULL);
+
+    const char *worker_fd = getenv("FSH_WORKER_FD");
+    if (worker_fd != NULL) {
+        worker_main(atoi(worker_fd)); // Não retorna
+    }
+
+    const char *event_fd = getenv("FSH_EVENT_FD");
+    if (event_fd != NULL && fcntl(atoi(event_fd), F_GETFD) >= 0) {
+        notifier.event_fd = atoi(event_fd);
+    }
+    const char *record_path = getenv("FSH_RECORD");
+    if (record_path != NULL && *record_path != '\0') {
+        session_open(record_path);
+    }
+    const char *board_path = getenv("FSH_BOARD");
+    if (board_path != NULL && *board_path != '\0') {
+        board_open(board_path);
+    }
+    job_log_open();
+    start_metrics_exporter();
+    // Descendentes órfãos dos jobs são adotados pela shell, que os reapa. Só
+    // depois do exportador, que deve ficar com o init e não com a shell.
+    if (prctl(PR_SET_CHILD_SUBREAPER, 1) < 0) {
+        perror("Erro ao tornar a shell subreaper");
+    }
+    wheel_init();
+
+    char buffer[MAX_BUFFER];
+    int show_prompt = 1;
+
+    while (1) {
+        if (show_prompt) {
+            printf("fsh> ");
+            fflush(stdout);
+            show_prompt = 0;
+        }
+
+        if (!next_input_line(buffer)) {
+            if (input_eof) {
+                output_pump(NULL, 0); // O que já está nos pipes não se perde
+                notify_flush();
+                printf("\n");
+                exit(0);
+            }
+            // Esperar por entrada, acordando periodicamente para reapar e
+            // lançar os comandos que aguardam admissão
+            struct pollfd pfds[2 + MAX_OUTPUT_STREAMS + MAX_WORKERS] = {
+                { .fd = STDIN_FILENO, .events = POLLIN },
+                { .fd = wheel.fd, .events = POLLIN },
+            };
+            int nout = output_poll_fds(pfds + 2);
+            int nfds = 2 + nout + workers_poll_fds(pfds + 2 + nout);
+            int ready = poll(pfds, nfds, admission_len > 0 || arrays_waiting() ? ADMISSION_POLL_MS : 1000);
+            if (ready > 0 && (pfds[0].revents & (POLLIN | POLLHUP))) {
+                fill_input();
+            } else if (ready < 0 && errno != EINTR) {
+                perror("Erro no poll");
+            }
+            if (ready > 0 && (pfds[1].revents & POLLIN)) {
+                wheel_run();
+            }
+            if (ready > 0 && nout > 0 && output_pump(pfds + 2, 1)) {
+                show_prompt = 1; // Redesenhar o prompt depois da saída dos jobs
+            }
+            if (ready > 0 && num_workers > 0) {
+                workers_pump(pfds + 2 + nout);
+            }
+            reap_background_processes();
+            drain_admission_queue();
+            memguard_check();
+            gang_check();
+            run_arrays();
+            tasks_run();
+            board_update();
+            notify_flush();
+            continue;
+        }
+        show_prompt = 1;
+        session_event(SESSION_INPUT, 0, 0, 0, buffer, strlen(buffer));
+
+        run_line(buffer);
+
+        reap_background_processes();
+        drain_admission_queue();
+        gang_check();
+        run_arrays();
+        tasks_run();
+        board_update();
+        notify_flush();
+    }
+
+    return 0;
+}
@@ -0,0 +1,291 @@
+// Reprodução de sessões gravadas pela fsh (formato em session.h).
+//
+//   gcc -O2 -o replay replay.c
+//   replay [-s VELOCIDADE] [-o nova.rec] [-v] sessao.rec ./fsh
+//   replay -c antes.rec depois.rec
+//
+// No primeiro modo a fsh é executada em um pseudo-terminal e recebe as linhas
+// gravadas nos mesmos instantes, divididos pela velocidade (-s 0 envia tudo
+// sem esperar). Os SIGINT e SIGTSTP são reenviados à shell, junto com a
+// resposta dada à confirmação do Ctrl-C. Com -o a shell reproduzida grava a
+// própria sessão, que pode ser comparada com a original pelo modo -c.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include "session.h"
+
+#define MAX_SAMPLES 1000000
+
+typedef struct {
+    SessionEvent *events;
+    char **data;          // Linha de cada SESSION_INPUT
+    int count;
+} Session;
+
+typedef struct {
+    int64_t *v;
+    int count;
+} Samples;
+
+int64_t mono_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int load_session(const char *path, Session *session) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        perror(path);
+        return -1;
+    }
+    SessionHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || strcmp(header.magic, SESSION_MAGIC) != 0) {
+        fprintf(stderr, "%s: não é uma sessão gravada pela fsh\n", path);
+        fclose(file);
+        return -1;
+    }
+    int capacity = 1024;
+    session->events = malloc(capacity * sizeof(SessionEvent));
+    session->data = malloc(capacity * sizeof(char *));
+    session->count = 0;
+    SessionEvent ev;
+    while (fread(&ev, sizeof(ev), 1, file) == 1) {
+        if (session->count == capacity) {
+            capacity *= 2;
+            session->events = realloc(session->events, capacity * sizeof(SessionEvent));
+            session->data = realloc(session->data, capacity * sizeof(char *));
+        }
+        char *data = NULL;
+        if (ev.len > 0) {
+            data = malloc(ev.len);
+            if (fread(data, 1, ev.len, file) != ev.len) {
+                free(data);
+                break; // Gravação cortada no meio de um evento
+            }
+        }
+        session->events[session->count] = ev;
+        session->data[session->count++] = data;
+    }
+    fclose(file);
+    return 0;
+}
+
+// Lê (e descarta, ou mostra com -v) a saída da shell até 'deadline'
+void drain_until(int master, int64_t deadline, int verbose) {
+    char buf[4096];
+    while (1) {
+        int64_t left = deadline - mono_ns();
+        struct pollfd pfd = { .fd = master, .events = POLLIN };
+        int ready = poll(&pfd, 1, left > 0 ? (int)((left + 999999) / 1000000) : 0);
+        if (ready <= 0) {
+            if (ready < 0 && errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        ssize_t n = read(master, buf, sizeof(buf));
+        if (n <= 0) {
+            return; // EIO: a shell fechou o terminal
+        }
+        if (verbose) {
+            fwrite(buf, 1, n, stdout);
+            fflush(stdout);
+        }
+    }
+}
+
+int replay(const char *path, const char *shell, double speed, const char *out_path, int verbose) {
+    Session session;
+    if (load_session(path, &session) < 0) {
+        return 1;
+    }
+
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0) {
+        perror("Erro ao criar o pseudo-terminal");
+        return 1;
+    }
+    char *slave_name = ptsname(master);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("Erro no fork");
+        return 1;
+    }
+    if (pid == 0) {
+        setsid();
+        int slave = open(slave_name, O_RDWR);
+        if (slave < 0) {
+            perror("Erro ao abrir o pseudo-terminal");
+            exit(1);
+        }
+        ioctl(slave, TIOCSCTTY, 0);
+        dup2(slave, STDIN_FILENO);
+        dup2(slave, STDOUT_FILENO);
+        dup2(slave, STDERR_FILENO);
+        close(slave);
+        close(master);
+        if (out_path != NULL) {
+            setenv("FSH_RECORD", out_path, 1);
+        }
+        execl(shell, shell, (char *)NULL);
+        perror("Erro ao executar a shell");
+        exit(1);
+    }
+
+    int64_t start = mono_ns();
+    for (int i = 0; i < session.count; i++) {
+        SessionEvent *ev = &session.events[i];
+        int64_t at = speed > 0 ? start + (int64_t)(ev->t_ns / speed) : 0;
+        drain_until(master, at, verbose);
+        if (ev->type == SESSION_INPUT) {
+            if (write(master, session.data[i], ev->len) < 0) {
+                break; // A shell já terminou
+            }
+        } else if (ev->type == SESSION_SIGINT) {
+            kill(pid, SIGINT);
+            if (ev->answer != 0) {
+                char answer[2] = { (char)ev->answer, '\n' };
+                drain_until(master, mono_ns() + 50000000LL, verbose); // Esperar a pergunta
+                if (write(master, answer, 2) < 0) {
+                    break;
+                }
+            }
+        } else if (ev->type == SESSION_SIGTSTP) {
+            kill(pid, SIGTSTP);
+        }
+    }
+
+    // Fim da gravação: EOF no terminal, como um Ctrl-D
+    char eof = 4;
+    if (write(master, &eof, 1) < 0) {
+        // A shell já saiu (por exemplo, com die)
+    }
+    int status;
+    while (waitpid(pid, &status, WNOHANG) == 0) {
+        drain_until(master, mono_ns() + 100000000LL, verbose);
+    }
+    drain_until(master, 0, verbose);
+    close(master);
+    printf("Sessão de %d eventos reproduzida em %.3fs (gravada em %.3fs)\n", session.count,
+           (mono_ns() - start) / 1e9, session.count > 0 ? session.events[session.count - 1].t_ns / 1e9 : 0);
+    return 0;
+}
+
+int compare_int64(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+void add_sample(Samples *s, int64_t v) {
+    if (s->count < MAX_SAMPLES) {
+        s->v[s->count++] = v;
+    }
+}
+
+// Latência entre cada linha e o primeiro processo criado por ela, e duração
+// de cada processo (início ao reap, casados pelo PID)
+void session_samples(Session *session, Samples *spawn, Samples *duration, int counts[6]) {
+    spawn->v = malloc(MAX_SAMPLES * sizeof(int64_t));
+    duration->v = malloc(MAX_SAMPLES * sizeof(int64_t));
+    spawn->count = duration->count = 0;
+    memset(counts, 0, 6 * sizeof(int));
+    int64_t input_ns = -1;
+    for (int i = 0; i < session->count; i++) {
+        SessionEvent *ev = &session->events[i];
+        if (ev->type < 6) {
+            counts[ev->type]++;
+        }
+        if (ev->type == SESSION_INPUT) {
+            input_ns = ev->t_ns;
+        } else if (ev->type == SESSION_JOB_START && input_ns >= 0) {
+            add_sample(spawn, ev->t_ns - input_ns);
+            input_ns = -1;
+        } else if (ev->type == SESSION_JOB_END) {
+            for (int j = i - 1; j >= 0; j--) {
+                if (session->events[j].type == SESSION_JOB_START && session->events[j].pid == ev->pid) {
+                    add_sample(duration, ev->t_ns - session->events[j].t_ns);
+                    break;
+                }
+            }
+        }
+    }
+    qsort(spawn->v, spawn->count, sizeof(int64_t), compare_int64);
+    qsort(duration->v, duration->count, sizeof(int64_t), compare_int64);
+}
+
+double percentile_ms(Samples *s, double p) {
+    if (s->count == 0) {
+        return 0;
+    }
+    int i = (int)(p / 100 * (s->count - 1) + 0.5);
+    return s->v[i] / 1e6;
+}
+
+void print_comparison(const char *name, Samples *a, Samples *b) {
+    static const double ps[] = { 50, 90, 99, 100 };
+    printf("%s (ms, %d x %d amostras)\n", name, a->count, b->count);
+    for (int i = 0; i < 4; i++) {
+        double x = percentile_ms(a, ps[i]), y = percentile_ms(b, ps[i]);
+        printf("  p%-3.0f %10.3f %10.3f  %+7.1f%%\n", ps[i], x, y, x > 0 ? 100 * (y - x) / x : 0);
+    }
+}
+
+int compare(const char *path_a, const char *path_b) {
+    static const char *names[] = { "", "linhas", "SIGINT", "SIGTSTP", "processos criados", "processos reapados" };
+    Session a, b;
+    if (load_session(path_a, &a) < 0 || load_session(path_b, &b) < 0) {
+        return 1;
+    }
+    Samples spawn_a, spawn_b, duration_a, duration_b;
+    int counts_a[6], counts_b[6];
+    session_samples(&a, &spawn_a, &duration_a, counts_a);
+    session_samples(&b, &spawn_b, &duration_b, counts_b);
+
+    printf("%-20s %10s %10s\n", "", "A", "B");
+    for (int t = SESSION_INPUT; t <= SESSION_JOB_END; t++) {
+        printf("%-20s %10d %10d%s\n", names[t], counts_a[t], counts_b[t],
+               counts_a[t] != counts_b[t] ? "  (diferente)" : "");
+    }
+    print_comparison("Linha até o primeiro processo", &spawn_a, &spawn_b);
+    print_comparison("Duração dos processos", &duration_a, &duration_b);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    double speed = 1;
+    const char *out_path = NULL;
+    int verbose = 0, compare_mode = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:o:vc")) != -1) {
+        switch (opt) {
+        case 's': speed = atof(optarg); break;
+        case 'o': out_path = optarg; break;
+        case 'v': verbose = 1; break;
+        case 'c': compare_mode = 1; break;
+        default:
+            fprintf(stderr, "Uso: %s [-s VELOCIDADE] [-o nova.rec] [-v] sessao.rec fsh\n"
+                            "     %s -c a.rec b.rec\n", argv[0], argv[0]);
+            return 2;
+        }
+    }
+    if (argc - optind != 2) {
+        fprintf(stderr, "Uso: %s [-s VELOCIDADE] [-o nova.rec] [-v] sessao.rec fsh\n"
+                        "     %s -c a.rec b.rec\n", argv[0], argv[0]);
+        return 2;
+    }
+    if (compare_mode) {
+        return compare(argv[optind], argv[optind + 1]);
+    }
+    return replay(argv[optind], argv[optind + 1], speed, out_path, verbose);
+}
@@ -0,0 +1,35 @@
+// Formato binário das sessões gravadas pela fsh (FSH_RECORD ou builtin
+// record) e lidas pelo replay.c. O arquivo começa com um SessionHeader e
+// segue com SessionEvents; os de tipo SESSION_INPUT são seguidos de 'len'
+// bytes com a linha digitada. Os tempos são relativos ao início da gravação.
+#ifndef FSH_SESSION_H
+#define FSH_SESSION_H
+
+#include <stdint.h>
+
+#define SESSION_MAGIC "FSHREC1"
+
+enum {
+    SESSION_INPUT = 1,     // Linha lida do stdin
+    SESSION_SIGINT = 2,    // SIGINT recebido; answer é a resposta à confirmação (0 se não houve)
+    SESSION_SIGTSTP = 3,   // SIGTSTP recebido
+    SESSION_JOB_START = 4, // Processo criado
+    SESSION_JOB_END = 5,   // Processo reapado; status é o retornado por wait4
+};
+
+typedef struct {
+    char magic[8];
+    int64_t start_ns;      // CLOCK_REALTIME do início da gravação
+} SessionHeader;
+
+typedef struct {
+    int64_t t_ns;          // CLOCK_MONOTONIC desde o início da gravação
+    uint8_t type;
+    uint8_t answer;
+    uint16_t len;
+    int32_t pid;
+    int32_t status;
+    uint32_t reserved;
+} SessionEvent;
+
+#endif
@@ -0,0 +1,341 @@
+// Teste de longa duração da fsh, para vazamentos que só aparecem com o tempo.
+//
+//   gcc -O2 -o soak soak.c
+//   soak [-d SEGUNDOS] [-r LINHAS/s] [-i AMOSTRAGEM] [-w AQUECIMENTO] [-k REINICIO] ./fsh
+//
+// A shell recebe pelo stdin uma carga sintética: comandos com vários
+// processos em background, comandos em foreground e, de tempos em tempos, um
+// SIGTSTP (os grupos suspensos são retomados com SIGCONT logo depois). A cada
+// amostragem o /proc da shell é lido: zumbis, descritores abertos, RSS e
+// número de filhos. Com -k a shell recebe "die" e é reiniciada a cada
+// REINICIO segundos; ao final de cada shell é verificado se algum grupo de
+// processos sobreviveu ao die.
+//
+// Cada shell é avaliada separadamente: os valores da última janela de
+// amostras são comparados com os da primeira janela depois do aquecimento.
+// Picos passageiros não contam, só um mínimo da janela final acima do máximo
+// da inicial. O código de saída é 1 se algum vazamento for encontrado.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/wait.h>
+
+#define MAX_SAMPLES 100000
+#define WINDOW 10               // Amostras em cada janela de comparação
+#define RSS_TOLERANCE_KB 1024   // Crescimento de RSS aceito entre as janelas
+#define MAX_JOB_PGIDS 4096
+
+typedef struct {
+    double t;
+    int zombies;
+    int fds;
+    long rss_kb;
+    int children;
+} Sample;
+
+typedef struct {
+    pid_t pid;
+    int input;              // Escrita do stdin da shell
+    double started;
+    Sample samples[MAX_SAMPLES];
+    int count;
+    pid_t pgids[MAX_JOB_PGIDS]; // Grupos dos jobs, para conferir o die
+    int num_pgids;
+} Shell;
+
+Shell shell;
+unsigned int seed = 1;
+
+double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void start_shell(const char *path) {
+    int in[2];
+    if (pipe(in) < 0) {
+        perror("Erro no pipe");
+        exit(2);
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("Erro no fork");
+        exit(2);
+    }
+    if (pid == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        dup2(in[0], STDIN_FILENO);
+        dup2(null, STDOUT_FILENO);
+        dup2(null, STDERR_FILENO);
+        close(in[0]);
+        close(in[1]);
+        close(null);
+        execl(path, path, (char *)NULL);
+        _exit(127);
+    }
+    close(in[0]);
+    shell.pid = pid;
+    shell.input = in[1];
+    shell.started = now();
+    shell.count = 0;
+    shell.num_pgids = 0;
+}
+
+void send_line(const char *line) {
+    size_t len = strlen(line);
+    if (write(shell.input, line, len) != (ssize_t)len) {
+        perror("Erro ao escrever para a shell");
+    }
+}
+
+// Percorre os filhos diretos da shell: conta zumbis e guarda os grupos
+int scan_children(int *zombies, int resume) {
+    DIR *dir = opendir("/proc");
+    if (dir == NULL) {
+        return 0;
+    }
+    int children = 0;
+    *zombies = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] < '0' || entry->d_name[0] > '9') {
+            continue;
+        }
+        char path[300], buf[512];
+        snprintf(path, sizeof(path), "/proc/%s/stat", entry->d_name);
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            continue;
+        }
+        ssize_t n = read(fd, buf, sizeof(buf) - 1);
+        close(fd);
+        if (n <= 0) {
+            continue;
+        }
+        buf[n] = '\0';
+        char *p = strrchr(buf, ')'); // O nome do comando pode ter espaços
+        char state;
+        int ppid, pgid;
+        if (p == NULL || sscanf(p + 2, "%c %d %d", &state, &ppid, &pgid) != 3 || ppid != shell.pid) {
+            continue;
+        }
+        children++;
+        if (state == 'Z') {
+            (*zombies)++;
+            continue;
+        }
+        if (resume) {
+            kill(-pgid, SIGCONT);
+        }
+        int known = 0;
+        for (int i = 0; i < shell.num_pgids && !known; i++) {
+            known = shell.pgids[i] == pgid;
+        }
+        if (!known && shell.num_pgids < MAX_JOB_PGIDS && pgid != getpgrp()) {
+            shell.pgids[shell.num_pgids++] = pgid;
+        }
+    }
+    closedir(dir);
+    return children;
+}
+
+int count_fds(pid_t pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/fd", pid);
+    DIR *dir = opendir(path);
+    if (dir == NULL) {
+        return -1;
+    }
+    int n = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] != '.') {
+            n++;
+        }
+    }
+    closedir(dir);
+    return n;
+}
+
+long read_rss_kb(pid_t pid) {
+    char path[64];
+    long size, resident;
+    snprintf(path, sizeof(path), "/proc/%d/statm", pid);
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return -1;
+    }
+    int ok = fscanf(file, "%ld %ld", &size, &resident) == 2;
+    fclose(file);
+    return ok ? resident * (sysconf(_SC_PAGESIZE) / 1024) : -1;
+}
+
+void take_sample(double warmup) {
+    Sample s;
+    s.t = now() - shell.started;
+    s.children = scan_children(&s.zombies, 0);
+    s.fds = count_fds(shell.pid);
+    s.rss_kb = read_rss_kb(shell.pid);
+    printf("t=%8.1fs  zumbis=%3d  fds=%3d  rss=%6ldkB  filhos=%4d%s\n",
+           s.t, s.zombies, s.fds, s.rss_kb, s.children, s.t < warmup ? "  (aquecimento)" : "");
+    fflush(stdout);
+    if (s.t >= warmup && shell.count < MAX_SAMPLES) {
+        shell.samples[shell.count++] = s;
+    }
+}
+
+// Mínimo da janela final acima do máximo da janela inicial
+int grew(const char *name, long first_max, long last_min, long tolerance) {
+    if (last_min > first_max + tolerance) {
+        printf("VAZAMENTO: %s cresceu de no máximo %ld para no mínimo %ld\n", name, first_max, last_min);
+        return 1;
+    }
+    return 0;
+}
+
+int analyze_shell() {
+    if (shell.count < 2 * WINDOW) {
+        printf("Poucas amostras (%d) para avaliar esta shell\n", shell.count);
+        return 0;
+    }
+    long first[4] = { 0, 0, 0, 0 };
+    long last[4] = { -1, -1, -1, -1 };
+    for (int i = 0; i < WINDOW; i++) {
+        Sample *a = &shell.samples[i], *b = &shell.samples[shell.count - WINDOW + i];
+        long va[4] = { a->zombies, a->fds, a->rss_kb, a->children };
+        long vb[4] = { b->zombies, b->fds, b->rss_kb, b->children };
+        for (int k = 0; k < 4; k++) {
+            if (va[k] > first[k]) first[k] = va[k];
+            if (last[k] < 0 || vb[k] < last[k]) last[k] = vb[k];
+        }
+    }
+    int leaks = 0;
+    leaks += grew("zumbis", first[0], last[0], 0);
+    leaks += grew("descritores abertos", first[1], last[1], 0);
+    leaks += grew("RSS (kB)", first[2], last[2], RSS_TOLERANCE_KB);
+    leaks += grew("filhos", first[3], last[3], 0);
+    return leaks;
+}
+
+// Envia "die" e confere que a shell saiu e não deixou grupos para trás
+int stop_shell() {
+    int zombies;
+    scan_children(&zombies, 1);
+    send_line("die\n");
+    close(shell.input);
+    int status;
+    double deadline = now() + 10;
+    while (waitpid(shell.pid, &status, WNOHANG) == 0) {
+        if (now() > deadline) {
+            printf("FALHA: a shell não terminou 10s depois do die\n");
+            kill(shell.pid, SIGKILL);
+            waitpid(shell.pid, &status, 0);
+            return 1;
+        }
+        usleep(10000);
+    }
+    usleep(200000);
+    int survivors = 0;
+    for (int i = 0; i < shell.num_pgids; i++) {
+        if (kill(-shell.pgids[i], 0) == 0) {
+            survivors++;
+            kill(-shell.pgids[i], SIGKILL);
+        }
+    }
+    if (survivors > 0) {
+        printf("FALHA: %d grupos de processos sobreviveram ao die\n", survivors);
+    }
+    return survivors > 0;
+}
+
+// Uma linha da carga sintética: na maioria das vezes um leque de processos
+// curtos em background, às vezes um comando em foreground
+void send_workload() {
+    char line[512];
+    int kind = rand_r(&seed) % 10;
+    if (kind < 7) {
+        int n = rand_r(&seed) % 4 + 1;
+        int len = snprintf(line, sizeof(line), "true");
+        for (int i = 0; i < n; i++) {
+            len += snprintf(line + len, sizeof(line) - len, " # sleep 0.%02d", rand_r(&seed) % 50);
+        }
+        snprintf(line + len, sizeof(line) - len, "\n");
+    } else if (kind < 9) {
+        snprintf(line, sizeof(line), "true\n");
+    } else {
+        snprintf(line, sizeof(line), "jobs\n");
+    }
+    send_line(line);
+}
+
+int main(int argc, char *argv[]) {
+    double duration = 3600, rate = 20, interval = 5, warmup = 30, restart = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "d:r:i:w:k:")) != -1) {
+        switch (opt) {
+        case 'd': duration = atof(optarg); break;
+        case 'r': rate = atof(optarg); break;
+        case 'i': interval = atof(optarg); break;
+        case 'w': warmup = atof(optarg); break;
+        case 'k': restart = atof(optarg); break;
+        default: optind = argc; break;
+        }
+    }
+    if (optind != argc - 1 || rate <= 0 || interval <= 0) {
+        fprintf(stderr, "Uso: %s [-d SEGUNDOS] [-r LINHAS/s] [-i AMOSTRAGEM] [-w AQUECIMENTO] [-k REINICIO] fsh\n",
+                argv[0]);
+        return 2;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    const char *path = argv[optind];
+
+    int failures = 0, shells = 1;
+    double end = now() + duration;
+    start_shell(path);
+    double next_line = now(), next_sample = now(), next_tstp = now() + 10, resume_at = 0;
+    while (now() < end) {
+        double t = now();
+        if (waitpid(shell.pid, NULL, WNOHANG) == shell.pid) {
+            printf("FALHA: a shell terminou sozinha depois de %.1fs\n", t - shell.started);
+            return 1;
+        }
+        if (t >= next_line) {
+            send_workload();
+            next_line += 1 / rate;
+        }
+        if (t >= next_tstp) {
+            kill(shell.pid, SIGTSTP);
+            resume_at = t + 1.5; // O tratador da shell dorme 1s
+            next_tstp = t + 10;
+        }
+        if (resume_at > 0 && t >= resume_at) {
+            int zombies;
+            scan_children(&zombies, 1);
+            resume_at = 0;
+        }
+        if (t >= next_sample) {
+            take_sample(warmup);
+            next_sample += interval;
+        }
+        if (restart > 0 && t - shell.started >= restart) {
+            failures += analyze_shell() + stop_shell();
+            start_shell(path);
+            shells++;
+            next_line = next_sample = now();
+            next_tstp = now() + 10;
+        }
+        usleep(1000);
+    }
+    failures += analyze_shell() + stop_shell();
+
+    printf("%s: %d shells, %.0fs, %d falhas\n", failures ? "FALHOU" : "OK", shells, duration, failures);
+    return failures ? 1 : 0;
+}